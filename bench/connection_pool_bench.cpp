@@ -0,0 +1,99 @@
+// Acquire/release throughput of ConnectionPool from many threads against
+// one local endpoint: the shared path, where every acquire() and release()
+// hops to the loop thread, and the per-thread cache, where each thread
+// reuses its own connection through try_acquire_local()/release_local().
+//
+//   connection_pool_bench [threads] [shared iterations] [local iterations]
+
+#include <async_toolkit/network/connection_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+
+using namespace async_toolkit;
+using namespace async_toolkit::network;
+using namespace async_toolkit::reactor;
+
+static Connection::Ptr acquire(ConnectionPool& pool, const SocketAddress& endpoint) {
+    std::promise<Connection::Ptr> promise;
+    auto future = promise.get_future();
+    pool.acquire(endpoint, [&promise](Connection::Ptr connection) {
+        promise.set_value(std::move(connection));
+    });
+    return future.get();
+}
+
+// Runs body(thread_index) on every thread at once; returns seconds
+template<typename F>
+static double run_threads(size_t threads, F body) {
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&go, &body] {
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            body();
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, size_t threads, size_t iterations, double seconds) {
+    double pairs = static_cast<double>(threads) * iterations;
+    std::printf("%-13s %10.1f ns per pair per thread  %8.2f M pairs/s\n",
+                name, seconds * 1e9 / iterations, pairs / seconds / 1e6);
+}
+
+int main(int argc, char** argv) {
+    size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+    size_t shared_iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+    size_t local_iterations = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000000;
+
+    EventLoop loop;
+    TcpServer server(loop, SocketAddress::ipv4("127.0.0.1", 0));
+    std::vector<FileDescriptor> accepted;
+    server.set_connection_callback([&accepted](FileDescriptor fd) { accepted.push_back(fd); });
+    SocketAddress endpoint = server.address();
+    ConnectionPool pool(loop, {.max_size = threads * 2});
+    std::thread loop_thread([&loop] { loop.run(); });
+
+    std::printf("%zu threads\n", threads);
+    double seconds = run_threads(threads, [&] {
+        for (size_t i = 0; i < shared_iterations; ++i) {
+            pool.release(acquire(pool, endpoint));
+        }
+    });
+    report("shared", threads, shared_iterations, seconds);
+
+    std::atomic<size_t> misses{0};
+    seconds = run_threads(threads, [&] {
+        pool.release_local(endpoint, acquire(pool, endpoint));
+        for (size_t i = 0; i < local_iterations; ++i) {
+            Connection::Ptr connection = pool.try_acquire_local(endpoint);
+            if (!connection) {
+                misses.fetch_add(1, std::memory_order_relaxed);
+                connection = acquire(pool, endpoint);
+            }
+            pool.release_local(endpoint, std::move(connection));
+        }
+    });
+    report("thread-local", threads, local_iterations, seconds);
+    std::printf("local cache misses: %zu\n", misses.load());
+
+    loop.stop();
+    loop_thread.join();
+    for (FileDescriptor fd : accepted) {
+        close(fd);
+    }
+}
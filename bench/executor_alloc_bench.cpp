@@ -0,0 +1,106 @@
+// Heap allocations per task on ThreadPoolExecutor once warm. Global
+// operator new is replaced with a counting version; after a warm-up pass,
+// post() and submit() with small callables must not allocate at all.
+// Exits with status 1 if they do.
+//
+//   executor_alloc_bench [threads] [tasks]
+
+#include <async_toolkit/executor/thread_pool_executor.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* block = std::malloc(size ? size : 1)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t alignment = std::max(static_cast<size_t>(align), sizeof(void*));
+    if (void* block = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept { std::free(block); }
+void operator delete(void* block, size_t) noexcept { std::free(block); }
+void operator delete(void* block, std::align_val_t) noexcept { std::free(block); }
+void operator delete(void* block, size_t, std::align_val_t) noexcept { std::free(block); }
+
+using async_toolkit::executor::Future;
+using async_toolkit::executor::ThreadPoolExecutor;
+
+// Runs pass twice and reports the allocations of the second run
+template<typename Pass>
+static bool measure(const char* name, size_t tasks, Pass pass) {
+    pass(tasks);
+    size_t before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    pass(tasks);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t count = allocations.load() - before;
+    std::printf("%-24s %10.0f tasks/s  %zu allocations (%.4f per task)\n",
+                name, tasks / seconds, count, static_cast<double>(count) / tasks);
+    return count == 0;
+}
+
+int main(int argc, char** argv) {
+    size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+    size_t tasks = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200000;
+    constexpr size_t WINDOW = 256;
+
+    ThreadPoolExecutor executor(threads, 2 * WINDOW);
+    std::vector<Future<size_t>> futures;
+    futures.reserve(WINDOW);
+    bool ok = true;
+
+    ok &= measure("post", tasks, [&](size_t n) {
+        std::atomic<size_t> done{0};
+        for (size_t i = 0; i < n; ++i) {
+            while (i - done.load(std::memory_order_acquire) >= WINDOW) {
+                std::this_thread::yield();
+            }
+            executor.post([&done] { done.fetch_add(1, std::memory_order_release); });
+        }
+        while (done.load(std::memory_order_acquire) < n) {
+            std::this_thread::yield();
+        }
+    });
+
+    ok &= measure("submit + get", tasks, [&](size_t n) {
+        for (size_t i = 0; i < n; i += WINDOW) {
+            for (size_t j = i; j < std::min(n, i + WINDOW); ++j) {
+                futures.push_back(executor.submit([j] { return j; }));
+            }
+            for (auto& future : futures) {
+                future.get();
+            }
+            futures.clear();
+        }
+    });
+
+    ok &= measure("submit with arguments", tasks, [&](size_t n) {
+        for (size_t i = 0; i < n; i += WINDOW) {
+            for (size_t j = i; j < std::min(n, i + WINDOW); ++j) {
+                futures.push_back(executor.submit([](size_t a, size_t b) { return a + b; }, j, 1));
+            }
+            for (auto& future : futures) {
+                future.get();
+            }
+            futures.clear();
+        }
+    });
+
+    return ok ? 0 : 1;
+}
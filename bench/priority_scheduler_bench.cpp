@@ -0,0 +1,52 @@
+// Throughput of PriorityScheduler in EXACT and MULTI_QUEUE mode: producer
+// threads schedule tasks with mixed priorities, and the clock stops when
+// the workers have run all of them.
+//
+//   priority_scheduler_bench [workers] [producers] [tasks]
+
+#include <async_toolkit/scheduler/priority_scheduler.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace async_toolkit::scheduler;
+
+static double run(SchedulingMode mode, size_t workers, size_t producers, size_t tasks) {
+    std::atomic<size_t> done{0};
+    PriorityScheduler scheduler(workers, mode);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (size_t i = p; i < tasks; i += producers) {
+                scheduler.schedule([&done] { done.fetch_add(1, std::memory_order_relaxed); },
+                                   static_cast<int>(i % 16));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    while (done.load(std::memory_order_relaxed) < tasks) {
+        std::this_thread::yield();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    size_t workers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : cores;
+    size_t producers = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : cores;
+    size_t tasks = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000000;
+
+    std::printf("%zu workers, %zu producers, %zu tasks\n", workers, producers, tasks);
+    for (auto [mode, name] : {std::pair{SchedulingMode::EXACT, "EXACT"},
+                              std::pair{SchedulingMode::MULTI_QUEUE, "MULTI_QUEUE"}}) {
+        double seconds = run(mode, workers, producers, tasks);
+        std::printf("%-12s %8.1f ms  %10.0f tasks/s\n", name, seconds * 1000, tasks / seconds);
+    }
+}
@@ -0,0 +1,87 @@
+// Makespan of CompiledTaskGraph with ReadyOrder::FIFO and CRITICAL_PATH on
+// random DAGs run by a WorkStealingScheduler. Every tenth node is heavy and
+// chained to the previous heavy node; the rest are light with up to two
+// random predecessors. Tasks sleep for their cost, so the result does not
+// depend on core count. Makespans are reported as a ratio of the lower
+// bound max(critical path, total work / workers).
+//
+//   task_graph_critical_path_bench [workers] [nodes] [graphs] [seed]
+
+#include <async_toolkit/graph/task_graph.hpp>
+#include <async_toolkit/scheduler/work_stealing_scheduler.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace async_toolkit;
+
+using Graph = graph::TaskGraph<size_t>;
+
+// Costs are in microseconds
+static Graph make_graph(size_t nodes, std::mt19937& rng, double& total_cost) {
+    Graph graph;
+    std::vector<Graph::NodePtr> added;
+    total_cost = 0.0;
+    for (size_t i = 0; i < nodes; ++i) {
+        double cost = i % 10 == 0 ? 2000.0 + rng() % 2000 : 100.0 + rng() % 400;
+        total_cost += cost;
+        added.push_back(graph.add_task([cost, i] {
+            std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(cost));
+            return i;
+        }, cost));
+    }
+    for (size_t i = 1; i < nodes; ++i) {
+        if (i % 10 == 0) {
+            graph.add_dependency(added[i], added[i - 10]);
+            continue;
+        }
+        for (size_t edges = rng() % 3; edges > 0; --edges) {
+            graph.add_dependency(added[i], added[rng() % i]);
+        }
+    }
+    return graph;
+}
+
+template<typename Compiled>
+static double makespan(Compiled& compiled, scheduler::WorkStealingScheduler& scheduler,
+                       graph::ReadyOrder order) {
+    auto start = std::chrono::steady_clock::now();
+    compiled.run(scheduler, order);
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t workers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4;
+    size_t nodes = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 400;
+    size_t graphs = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 8;
+    unsigned seed = argc > 4 ? static_cast<unsigned>(std::strtoul(argv[4], nullptr, 10)) : 7;
+
+    scheduler::WorkStealingScheduler scheduler(workers);
+    std::mt19937 rng(seed);
+    double fifo_sum = 0.0;
+    double critical_sum = 0.0;
+
+    std::printf("%zu workers, %zu graphs of %zu nodes, seed %u\n", workers, graphs, nodes, seed);
+    std::printf("%5s %10s %10s %10s %8s %8s\n", "graph", "bound us", "fifo us", "cp us", "fifo", "cp");
+    for (size_t g = 0; g < graphs; ++g) {
+        double total_cost;
+        Graph graph = make_graph(nodes, rng, total_cost);
+        auto compiled = graph.compile();
+        double bound = std::max(compiled.critical_path(), total_cost / workers);
+
+        makespan(compiled, scheduler, graph::ReadyOrder::FIFO);   // Warm-up
+        double fifo = makespan(compiled, scheduler, graph::ReadyOrder::FIFO);
+        double critical = makespan(compiled, scheduler, graph::ReadyOrder::CRITICAL_PATH);
+        fifo_sum += fifo / bound;
+        critical_sum += critical / bound;
+        std::printf("%5zu %10.0f %10.0f %10.0f %8.2f %8.2f\n",
+                    g, bound, fifo, critical, fifo / bound, critical / bound);
+    }
+    std::printf("mean makespan / bound: FIFO %.2f, CRITICAL_PATH %.2f\n",
+                fifo_sum / graphs, critical_sum / graphs);
+}
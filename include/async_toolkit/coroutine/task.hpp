@@ -1,13 +1,54 @@
 #pragma once
 
+#include <condition_variable>
 #include <coroutine>
 #include <exception>
+#include <mutex>
 #include <stdexcept>
 #include <concepts>
 #include <type_traits>
 
 namespace async_toolkit::coroutine {
 
+namespace detail {
+
+// Completion flag of a task's promise. A task suspended in an awaitable is
+// owned by whatever resumes it (an EventLoop, a timer thread), so get()
+// waits for the final suspend point instead of resuming it.
+struct TaskCompletion {
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+
+    // Final awaiter: publishes completion once the body, including the
+    // result or exception, has finished
+    struct Signal {
+        TaskCompletion& completion;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<>) const noexcept {
+            std::lock_guard lock(completion.mutex);
+            completion.done = true;
+            completion.condition.notify_all();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    Signal signal() noexcept { return {*this}; }
+
+    bool is_done() {
+        std::lock_guard lock(mutex);
+        return done;
+    }
+
+    void wait() {
+        std::unique_lock lock(mutex);
+        condition.wait(lock, [this] { return done; });
+    }
+};
+
+} // namespace detail
+
 template<typename T = void>
 class [[nodiscard]] Task {
 public:
@@ -17,13 +58,14 @@ public:
     struct promise_type {
         T result;
         std::exception_ptr exception;
+        detail::TaskCompletion completion;
 
         Task get_return_object() {
             return Task(handle_type::from_promise(*this));
         }
 
         std::suspend_never initial_suspend() { return {}; }
-        std::suspend_always final_suspend() noexcept { return {}; }
+        detail::TaskCompletion::Signal final_suspend() noexcept { return completion.signal(); }
 
         template<typename U>
         requires std::convertible_to<U, T>
@@ -55,9 +97,13 @@ public:
         return *this;
     }
 
+    // Tasks start eagerly, so a task that is not done is suspended in an
+    // awaitable that will resume it; get() blocks until it finishes and
+    // must not be called on the thread that resumes it, such as the loop
+    // thread of an AsyncSocket it awaits
     T get() {
         if (coro_) {
-            coro_.resume();
+            coro_.promise().completion.wait();
             if (coro_.promise().exception)
                 std::rethrow_exception(coro_.promise().exception);
             return std::move(coro_.promise().result);
@@ -66,7 +112,7 @@ public:
     }
 
     bool is_ready() const {
-        return coro_ && coro_.done();
+        return coro_ && coro_.promise().completion.is_done();
     }
 
 private:
@@ -79,13 +125,14 @@ class Task<void> {
 public:
     struct promise_type {
         std::exception_ptr exception;
+        detail::TaskCompletion completion;
 
         Task<void> get_return_object() {
             return Task<void>(std::coroutine_handle<promise_type>::from_promise(*this));
         }
 
         std::suspend_never initial_suspend() { return {}; }
-        std::suspend_always final_suspend() noexcept { return {}; }
+        detail::TaskCompletion::Signal final_suspend() noexcept { return completion.signal(); }
         void return_void() {}
 
         void unhandled_exception() {
@@ -114,16 +161,17 @@ public:
         return *this;
     }
 
+    // Blocks until the task finishes; see Task<T>::get()
     void get() {
         if (coro_) {
-            coro_.resume();
+            coro_.promise().completion.wait();
             if (coro_.promise().exception)
                 std::rethrow_exception(coro_.promise().exception);
         }
     }
 
     bool is_ready() const {
-        return coro_ && coro_.done();
+        return coro_ && coro_.promise().completion.is_done();
     }
 
 private:
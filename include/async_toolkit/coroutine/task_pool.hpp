@@ -10,6 +10,8 @@
 #include <memory>
 #include <type_traits>
 #include <concepts>
+#include "../executor/future.hpp"
+#include "../executor/unique_function.hpp"
 
 namespace async_toolkit {
 
@@ -20,7 +22,7 @@ public:
         for(size_t i = 0; i < thread_count; ++i) {
             workers_.emplace_back([this] {
                 while(true) {
-                    std::function<void()> task;
+                    executor::UniqueFunction<void()> task;
                     {
                         std::unique_lock lock(queue_mutex_);
                         condition_.wait(lock, [this] {
@@ -55,20 +57,26 @@ public:
     requires std::invocable<F, Args...>
     auto submit(F&& f, Args&&... args) {
         using return_type = std::invoke_result_t<F, Args...>;
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-        
-        std::future<return_type> result = task->get_future();
+        executor::Promise<return_type> promise;
+        executor::Future<return_type> result = promise.get_future();
+        post([promise = std::move(promise),
+              func = std::bind(std::forward<F>(f), std::forward<Args>(args)...)]() mutable {
+            executor::detail::fulfil(promise, func);
+        });
+        return result;
+    }
+
+    // Fire-and-forget submission, also what Future::then posts continuations with
+    template<typename F>
+    void post(F&& f) {
         {
             std::unique_lock lock(queue_mutex_);
             if(stop_) {
                 throw std::runtime_error("Cannot submit task to stopped ThreadPool");
             }
-            tasks_.emplace([task]() { (*task)(); });
+            tasks_.emplace(std::forward<F>(f));
         }
         condition_.notify_one();
-        return result;
     }
 
     template<typename Pipeline, typename T>
@@ -90,7 +98,7 @@ public:
 
 private:
     std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
+    std::queue<executor::UniqueFunction<void()>> tasks_;
     mutable std::mutex queue_mutex_;
     std::condition_variable condition_;
     bool stop_;
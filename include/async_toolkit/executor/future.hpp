@@ -0,0 +1,737 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "unique_function.hpp"
+
+namespace async_toolkit::executor {
+
+template<typename T> class Future;
+template<typename T> class Promise;
+
+// Anything tasks can be posted to: ThreadPoolExecutor, TaskPool, InlineExecutor
+template<typename E>
+concept Executor = requires(E& executor, UniqueFunction<void()> task) {
+    executor.post(std::move(task));
+};
+
+// Runs continuations on the thread that completes the antecedent
+struct InlineExecutor {
+    template<typename F>
+    void post(F&& f) {
+        std::forward<F>(f)();
+    }
+};
+
+namespace detail {
+
+template<typename T>
+struct is_future : std::false_type {};
+
+template<typename T>
+struct is_future<Future<T>> : std::true_type {};
+
+// Recycles the blocks of shared states of one size and alignment. Each
+// thread keeps a small free list; frees past 2 * BATCH move a batch to a
+// shared list and an empty thread takes a batch back, so a producer whose
+// states are freed by consumers still stops allocating once warm. Only
+// batch moves take the mutex.
+template<size_t Size, size_t Align>
+class StateAllocator {
+    struct Node {
+        Node* next;
+    };
+
+    static_assert(Size >= sizeof(Node));
+
+    static constexpr size_t BATCH = 32;
+    static constexpr size_t MAX_SHARED = 64 * BATCH;
+
+    // Trivially destructible so it stays usable while the thread exits
+    struct LocalList {
+        Node* head;
+        size_t count;
+        bool closed;
+    };
+
+    struct SharedList {
+        std::mutex mutex;
+        Node* head = nullptr;
+        size_t count = 0;
+
+        ~SharedList() {
+            free_list(head);
+        }
+    };
+
+    // Returns the thread's blocks to the heap when the thread exits
+    struct LocalDrain {
+        ~LocalDrain() {
+            free_list(local_.head);
+            local_ = {nullptr, 0, true};
+        }
+    };
+
+public:
+    static void* allocate() {
+        if (!local_.head && !local_.closed) {
+            register_drain();
+            SharedList& shared = shared_list();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            while (shared.head && local_.count < BATCH) {
+                Node* node = shared.head;
+                shared.head = node->next;
+                --shared.count;
+                node->next = local_.head;
+                local_.head = node;
+                ++local_.count;
+            }
+        }
+        if (Node* node = local_.head) {
+            local_.head = node->next;
+            --local_.count;
+            return node;
+        }
+        // Grow by a whole batch: blocks parked in other threads' lists
+        // would otherwise cause a trickle of misses before the pool settles
+        if (!local_.closed) {
+            for (size_t i = 1; i < BATCH; ++i) {
+                auto* node = static_cast<Node*>(::operator new(Size, std::align_val_t(Align)));
+                node->next = local_.head;
+                local_.head = node;
+                ++local_.count;
+            }
+        }
+        return ::operator new(Size, std::align_val_t(Align));
+    }
+
+    static void deallocate(void* block) noexcept {
+        if (local_.closed) {
+            ::operator delete(block, std::align_val_t(Align));
+            return;
+        }
+        register_drain();
+        auto* node = static_cast<Node*>(block);
+        node->next = local_.head;
+        local_.head = node;
+        if (++local_.count >= 2 * BATCH) {
+            release_batch();
+        }
+    }
+
+private:
+    static void free_list(Node* node) noexcept {
+        while (node) {
+            Node* next = node->next;
+            ::operator delete(node, std::align_val_t(Align));
+            node = next;
+        }
+    }
+
+    static void register_drain() {
+        static thread_local LocalDrain drain;
+        (void)drain;
+    }
+
+    static SharedList& shared_list() {
+        static SharedList shared;
+        return shared;
+    }
+
+    static void release_batch() noexcept {
+        Node* batch = nullptr;
+        for (size_t i = 0; i < BATCH; ++i) {
+            Node* node = local_.head;
+            local_.head = node->next;
+            node->next = batch;
+            batch = node;
+        }
+        local_.count -= BATCH;
+        SharedList& shared = shared_list();
+        std::unique_lock<std::mutex> lock(shared.mutex);
+        if (shared.count >= MAX_SHARED) {
+            lock.unlock();
+            free_list(batch);
+            return;
+        }
+        while (batch) {
+            Node* node = batch;
+            batch = node->next;
+            node->next = shared.head;
+            shared.head = node;
+            ++shared.count;
+        }
+    }
+
+    inline static thread_local LocalList local_{nullptr, 0, false};
+};
+
+// Shared state of a Promise/Future pair, allocated once. Completion and the
+// continuation race through a single atomic: whichever of set_result and
+// set_callback comes second runs the callback, so no lock is needed.
+template<typename T>
+class SharedState {
+    using Value = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    static constexpr uint32_t RESULT = 1;
+    static constexpr uint32_t CALLBACK = 2;
+
+public:
+    // Blocks are recycled, so a steady stream of promises allocates nothing
+    static void* operator new(size_t) {
+        return StateAllocator<sizeof(SharedState), alignof(SharedState)>::allocate();
+    }
+
+    static void operator delete(void* block) noexcept {
+        StateAllocator<sizeof(SharedState), alignof(SharedState)>::deallocate(block);
+    }
+
+    void add_ref() noexcept {
+        refs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() noexcept {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    template<typename... V>
+    void set_value(V&&... value) {
+        result_.template emplace<1>(std::forward<V>(value)...);
+        complete();
+    }
+
+    void set_exception(std::exception_ptr error) {
+        result_.template emplace<2>(std::move(error));
+        complete();
+    }
+
+    bool is_ready() const noexcept {
+        return flags_.load(std::memory_order_acquire) & RESULT;
+    }
+
+    void wait() const noexcept {
+        uint32_t flags = flags_.load(std::memory_order_acquire);
+        while (!(flags & RESULT)) {
+            flags_.wait(flags, std::memory_order_acquire);
+            flags = flags_.load(std::memory_order_acquire);
+        }
+    }
+
+    // Returns false without storing the callback if the result is already
+    // set; the caller then continues inline.
+    bool try_set_callback(UniqueFunction<void()>&& callback) {
+        if (is_ready()) {
+            return false;
+        }
+        callback_ = std::move(callback);
+        if (flags_.fetch_or(CALLBACK, std::memory_order_acq_rel) & RESULT) {
+            callback_ = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    // Runs the callback now if the result is already set
+    void set_callback(UniqueFunction<void()>&& callback) {
+        callback_ = std::move(callback);
+        if (flags_.fetch_or(CALLBACK, std::memory_order_acq_rel) & RESULT) {
+            run_callback();
+        }
+    }
+
+    bool has_exception() const noexcept {
+        return result_.index() == 2;
+    }
+
+    std::exception_ptr exception() const {
+        return std::get<2>(result_);
+    }
+
+    // Moves the value out; only valid once, from the owning Future
+    T take() {
+        if (has_exception()) {
+            std::rethrow_exception(std::get<2>(result_));
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(std::get<1>(result_));
+        }
+    }
+
+private:
+    void complete() {
+        uint32_t previous = flags_.fetch_or(RESULT, std::memory_order_acq_rel);
+        if (previous & CALLBACK) {
+            run_callback();
+        }
+        flags_.notify_all();
+    }
+
+    void run_callback() {
+        auto callback = std::move(callback_);
+        callback();
+    }
+
+    std::atomic<uint32_t> refs_{1};
+    std::atomic<uint32_t> flags_{0};
+    std::variant<std::monostate, Value, std::exception_ptr> result_;
+    UniqueFunction<void()> callback_;
+};
+
+// Intrusive owning pointer to a SharedState
+template<typename T>
+class StateRef {
+public:
+    StateRef() noexcept = default;
+    explicit StateRef(SharedState<T>* state) noexcept : state_(state) {}
+
+    StateRef(const StateRef& other) noexcept : state_(other.state_) {
+        if (state_) state_->add_ref();
+    }
+
+    StateRef(StateRef&& other) noexcept : state_(std::exchange(other.state_, nullptr)) {}
+
+    StateRef& operator=(StateRef other) noexcept {
+        std::swap(state_, other.state_);
+        return *this;
+    }
+
+    ~StateRef() {
+        if (state_) state_->release();
+    }
+
+    SharedState<T>* operator->() const noexcept { return state_; }
+    explicit operator bool() const noexcept { return state_ != nullptr; }
+
+private:
+    SharedState<T>* state_ = nullptr;
+};
+
+// Completes promise with the outcome of f(args...)
+template<typename T, typename F, typename... Args>
+void fulfil(Promise<T>& promise, F& f, Args&&... args) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            std::invoke(f, std::forward<Args>(args)...);
+            promise.set_value();
+        } else {
+            promise.set_value(std::invoke(f, std::forward<Args>(args)...));
+        }
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+    }
+}
+
+template<typename F, typename T>
+struct continuation {
+    using type = std::invoke_result_t<F, T>;
+};
+
+template<typename F>
+struct continuation<F, void> {
+    using type = std::invoke_result_t<F>;
+};
+
+template<typename R>
+struct unwrap {
+    using type = R;
+};
+
+template<typename U>
+struct unwrap<Future<U>> {
+    using type = U;
+};
+
+// Value type of the Future returned by then(): a continuation returning
+// Future<U> yields Future<U>, not Future<Future<U>>
+template<typename F, typename T>
+using then_value_t = typename unwrap<typename continuation<F, T>::type>::type;
+
+} // namespace detail
+
+template<typename T>
+class Future {
+public:
+    Future() noexcept = default;
+    Future(Future&&) noexcept = default;
+    Future& operator=(Future&&) noexcept = default;
+    Future(const Future&) = delete;
+    Future& operator=(const Future&) = delete;
+
+    bool valid() const noexcept { return static_cast<bool>(state_); }
+    bool is_ready() const { return state_ && state_->is_ready(); }
+
+    void wait() const {
+        check_valid();
+        state_->wait();
+    }
+
+    // Blocks until the result is available; consumes the future
+    T get() {
+        check_valid();
+        state_->wait();
+        auto state = std::move(state_);
+        return state->take();
+    }
+
+    // Runs f(value) on executor once the result is available. If this
+    // future fails, f is skipped and the returned future carries the error.
+    template<Executor E, typename F>
+    auto then(E& executor, F&& f) -> Future<detail::then_value_t<F, T>> {
+        check_valid();
+        using R = detail::then_value_t<F, T>;
+
+        Promise<R> promise;
+        Future<R> result = promise.get_future();
+        auto state = std::move(state_);
+        auto* raw = state.operator->();
+        raw->set_callback(
+            [&executor, state = std::move(state), f = std::forward<F>(f),
+             promise = std::move(promise)]() mutable {
+                // post() throws for a full or stopped pool, usually after
+                // destroying the task; the task then parks its promise in
+                // handoff so the rejection reaches the returned future
+                Handoff<R> handoff{promise.state_.operator->(), std::nullopt, Handoff<R>::current};
+                Handoff<R>::current = &handoff;
+                try {
+                    executor.post(Continuation<std::decay_t<F>, R>(
+                        std::move(state), std::move(f), std::move(promise)));
+                } catch (...) {
+                    Handoff<R>::current = handoff.outer;
+                    if (handoff.promise) {
+                        handoff.promise->set_exception(std::current_exception());
+                    }
+                    return;
+                }
+                Handoff<R>::current = handoff.outer;
+            });
+        return result;
+    }
+
+    // Inline continuation: f runs on the thread that completes this future
+    template<typename F>
+    auto then(F&& f) -> Future<detail::then_value_t<F, T>> {
+        return then(inline_executor(), std::forward<F>(f));
+    }
+
+    auto operator co_await() && {
+        struct Awaiter {
+            Future future;
+
+            bool await_ready() const { return future.is_ready(); }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                return future.state_->try_set_callback([handle] { handle.resume(); });
+            }
+
+            T await_resume() { return future.get(); }
+        };
+        check_valid();
+        return Awaiter{std::move(*this)};
+    }
+
+private:
+    template<typename> friend class Promise;
+    template<typename> friend class Future;
+    template<typename U>
+    friend Future<std::conditional_t<std::is_void_v<U>, void, std::vector<U>>>
+    when_all(std::vector<Future<U>> futures);
+    template<typename U>
+    friend auto when_any(std::vector<Future<U>> futures);
+
+    explicit Future(detail::StateRef<T> state) noexcept : state_(std::move(state)) {}
+
+    static InlineExecutor& inline_executor() {
+        static InlineExecutor executor;
+        return executor;
+    }
+
+    void check_valid() const {
+        if (!state_) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+
+    // Promise of a continuation task destroyed unrun while then() was
+    // posting it, found by its shared state
+    template<typename R>
+    struct Handoff {
+        const void* state;
+        std::optional<Promise<R>> promise;
+        Handoff* outer;
+
+        inline static thread_local Handoff* current = nullptr;
+    };
+
+    // The task then() posts. Destroyed without running, it breaks its
+    // promise, unless then() is still inside post() on this thread and
+    // takes the promise back to fail it with post()'s exception.
+    template<typename F, typename R>
+    class Continuation {
+    public:
+        Continuation(detail::StateRef<T>&& state, F&& f, Promise<R>&& promise)
+            : state_(std::move(state)), f_(std::move(f)), promise_(std::move(promise)) {}
+
+        Continuation(Continuation&&) = default;
+        Continuation& operator=(Continuation&&) = delete;
+
+        ~Continuation() {
+            Handoff<R>* handoff = Handoff<R>::current;
+            if (!ran_ && handoff && promise_.state_ &&
+                handoff->state == promise_.state_.operator->()) {
+                handoff->promise.emplace(std::move(promise_));
+            }
+        }
+
+        void operator()() {
+            ran_ = true;
+            run_continuation(state_, f_, promise_);
+        }
+
+    private:
+        detail::StateRef<T> state_;
+        F f_;
+        Promise<R> promise_;
+        bool ran_ = false;
+    };
+
+    template<typename F, typename R>
+    static void run_continuation(detail::StateRef<T>& state, F& f, Promise<R>& promise) {
+        if (state->has_exception()) {
+            promise.set_exception(state->exception());
+            return;
+        }
+
+        using Result = typename detail::continuation<F, T>::type;
+        if constexpr (detail::is_future<Result>::value) {
+            try {
+                Result inner = [&] {
+                    if constexpr (std::is_void_v<T>) return std::invoke(f);
+                    else return std::invoke(f, state->take());
+                }();
+                auto inner_state = std::move(inner.state_);
+                auto* raw = inner_state.operator->();
+                raw->set_callback(
+                    [inner_state = std::move(inner_state),
+                     promise = std::move(promise)]() mutable {
+                        if (inner_state->has_exception()) {
+                            promise.set_exception(inner_state->exception());
+                        } else if constexpr (std::is_void_v<R>) {
+                            promise.set_value();
+                        } else {
+                            promise.set_value(inner_state->take());
+                        }
+                    });
+            } catch (...) {
+                promise.set_exception(std::current_exception());
+            }
+        } else if constexpr (std::is_void_v<T>) {
+            detail::fulfil(promise, f);
+        } else {
+            detail::fulfil(promise, f, state->take());
+        }
+    }
+
+    detail::StateRef<T> state_;
+};
+
+template<typename T>
+class Promise {
+public:
+    Promise() : state_(new detail::SharedState<T>()) {}
+    Promise(Promise&&) noexcept = default;
+    Promise& operator=(Promise&& other) noexcept {
+        if (this != &other) {
+            abandon();
+            state_ = std::move(other.state_);
+            retrieved_ = other.retrieved_;
+            satisfied_ = other.satisfied_;
+        }
+        return *this;
+    }
+    Promise(const Promise&) = delete;
+    Promise& operator=(const Promise&) = delete;
+
+    // An unsatisfied promise breaks its future
+    ~Promise() {
+        abandon();
+    }
+
+    Future<T> get_future() {
+        check_state();
+        if (retrieved_) {
+            throw std::future_error(std::future_errc::future_already_retrieved);
+        }
+        retrieved_ = true;
+        return Future<T>(state_);
+    }
+
+    template<typename... V>
+    void set_value(V&&... value) {
+        check_unsatisfied();
+        satisfied_ = true;
+        state_->set_value(std::forward<V>(value)...);
+    }
+
+    void set_exception(std::exception_ptr error) {
+        check_unsatisfied();
+        satisfied_ = true;
+        state_->set_exception(std::move(error));
+    }
+
+private:
+    void check_state() const {
+        if (!state_) {
+            throw std::future_error(std::future_errc::no_state);
+        }
+    }
+
+    void check_unsatisfied() const {
+        check_state();
+        if (satisfied_) {
+            throw std::future_error(std::future_errc::promise_already_satisfied);
+        }
+    }
+
+    template<typename> friend class Future;
+
+    void abandon() {
+        if (state_ && !satisfied_) {
+            satisfied_ = true;
+            state_->set_exception(std::make_exception_ptr(
+                std::future_error(std::future_errc::broken_promise)));
+        }
+    }
+
+    detail::StateRef<T> state_;
+    bool retrieved_ = false;
+    bool satisfied_ = false;
+};
+
+template<typename T>
+Future<std::decay_t<T>> make_ready_future(T&& value) {
+    Promise<std::decay_t<T>> promise;
+    auto future = promise.get_future();
+    promise.set_value(std::forward<T>(value));
+    return future;
+}
+
+inline Future<void> make_ready_future() {
+    Promise<void> promise;
+    auto future = promise.get_future();
+    promise.set_value();
+    return future;
+}
+
+// Completes with every value in input order, or with the first error
+template<typename T>
+Future<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>>
+when_all(std::vector<Future<T>> futures) {
+    using Result = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+    using Slot = std::conditional_t<std::is_void_v<T>, std::monostate, std::optional<T>>;
+
+    struct Context {
+        Promise<Result> promise;
+        std::vector<Slot> values;
+        std::atomic<size_t> remaining;
+        std::atomic<bool> failed{false};
+    };
+
+    auto context = std::make_shared<Context>();
+    auto result = context->promise.get_future();
+    context->values.resize(futures.size());
+    context->remaining.store(futures.size());
+
+    if (futures.empty()) {
+        if constexpr (std::is_void_v<T>) context->promise.set_value();
+        else context->promise.set_value(std::vector<T>{});
+        return result;
+    }
+
+    for (size_t i = 0; i < futures.size(); ++i) {
+        auto state = std::move(futures[i].state_);
+        auto* raw = state.operator->();
+        raw->set_callback([context, i, state = std::move(state)]() mutable {
+            if (state->has_exception()) {
+                if (!context->failed.exchange(true)) {
+                    context->promise.set_exception(state->exception());
+                }
+                return;
+            }
+            if constexpr (!std::is_void_v<T>) {
+                context->values[i].emplace(state->take());
+            }
+            if (context->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+                !context->failed.exchange(true)) {
+                if constexpr (std::is_void_v<T>) {
+                    context->promise.set_value();
+                } else {
+                    std::vector<T> values;
+                    values.reserve(context->values.size());
+                    for (auto& value : context->values) {
+                        values.push_back(std::move(*value));
+                    }
+                    context->promise.set_value(std::move(values));
+                }
+            }
+        });
+    }
+    return result;
+}
+
+template<typename T>
+struct WhenAnyResult {
+    size_t index;
+    T value;
+};
+
+// Completes with the index (and value) of the first future to finish
+template<typename T>
+auto when_any(std::vector<Future<T>> futures) {
+    using Result = std::conditional_t<std::is_void_v<T>, size_t, WhenAnyResult<T>>;
+
+    struct Context {
+        Promise<Result> promise;
+        std::atomic<bool> done{false};
+    };
+
+    if (futures.empty()) {
+        throw std::invalid_argument("when_any requires at least one future");
+    }
+
+    auto context = std::make_shared<Context>();
+    auto result = context->promise.get_future();
+
+    for (size_t i = 0; i < futures.size(); ++i) {
+        auto state = std::move(futures[i].state_);
+        auto* raw = state.operator->();
+        raw->set_callback([context, i, state = std::move(state)]() mutable {
+            if (context->done.exchange(true)) {
+                return;
+            }
+            if (state->has_exception()) {
+                context->promise.set_exception(state->exception());
+            } else if constexpr (std::is_void_v<T>) {
+                context->promise.set_value(i);
+            } else {
+                context->promise.set_value(Result{i, state->take()});
+            }
+        });
+    }
+    return result;
+}
+
+} // namespace async_toolkit::executor
@@ -10,19 +10,95 @@
 #include <memory>
 #include <optional>
 #include <chrono>
+#include <stdexcept>
+#include <variant>
+#include <algorithm>
+#include <unordered_map>
+#include <atomic>
+#include "unique_function.hpp"
+#include "future.hpp"
 #include "../memory/memory_pool.hpp"
+#include "../logging/trace.hpp"
 
 namespace async_toolkit::executor {
 
+// What submit does when the queue already holds max_queue_size tasks
+enum class RejectionPolicy {
+    THROW,          // Throw std::runtime_error
+    BLOCK,          // Wait up to the block timeout for space, then throw
+    CALLER_RUNS,    // Run the task on the submitting thread; delayed tasks throw
+    DROP_OLDEST     // Discard the oldest ready task to make room
+};
+
+enum class SubmitError {
+    QUEUE_FULL,
+    SHUTDOWN
+};
+
+// Expected-style result of try_submit: the future, or why it was refused
+template<typename T>
+class SubmitResult {
+public:
+    SubmitResult(T value) : storage_(std::move(value)) {}
+    SubmitResult(SubmitError error) : storage_(error) {}
+
+    bool has_value() const noexcept { return storage_.index() == 0; }
+    explicit operator bool() const noexcept { return has_value(); }
+
+    T& value() {
+        if (!has_value()) {
+            throw std::runtime_error("SubmitResult holds an error");
+        }
+        return std::get<0>(storage_);
+    }
+
+    T& operator*() { return std::get<0>(storage_); }
+    T* operator->() { return &std::get<0>(storage_); }
+
+    SubmitError error() const { return std::get<1>(storage_); }
+
+private:
+    std::variant<T, SubmitError> storage_;
+};
+
+// Sizing of an elastic ThreadPoolExecutor. Workers above core_threads are
+// spawned on demand and retire after keep_alive without work.
+struct ThreadPoolOptions {
+    size_t core_threads = std::thread::hardware_concurrency();
+    size_t max_threads = std::thread::hardware_concurrency();
+    size_t max_queue_size = 10000;
+    std::chrono::milliseconds keep_alive{60000};
+    // Queue wait of the next task that triggers an extra worker
+    std::chrono::microseconds spawn_latency_threshold{1000};
+};
+
+enum class PoolEvent {
+    THREAD_SPAWNED,
+    THREAD_RETIRED
+};
+
+struct PoolStats {
+    size_t thread_count = 0;
+    size_t idle_threads = 0;
+    size_t blocked_threads = 0;
+    size_t spawned = 0;
+    size_t retired = 0;
+};
+
 class ThreadPoolExecutor {
+    // Task nodes live in task_pool_ and the queues only hold pointers, so
+    // heap sifts move 8 bytes and the callable is never copied.
     struct Task {
-        std::function<void()> func;
+        UniqueFunction<void()> func;
         int priority;
         std::chrono::steady_clock::time_point schedule_time;
+        uint64_t sequence;
+        uint64_t ready_at = 0;   // Trace timestamp, set only while tracing
 
-        Task(std::function<void()>&& f, int p = 0,
-             std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now())
-            : func(std::move(f)), priority(p), schedule_time(t) {}
+        Task(UniqueFunction<void()>&& f, int p = 0,
+             std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now(),
+             uint64_t seq = 0)
+            : func(std::move(f)), priority(p), schedule_time(t), sequence(seq) {}
 
         bool operator<(const Task& other) const {
             if (priority != other.priority)
@@ -31,14 +107,49 @@ class ThreadPoolExecutor {
         }
     };
 
-    using TaskPool = memory::MemoryPool<Task>;
+    using TaskPool = memory::MemoryPool<Task, 128>;
+
+    // Returns the node to task_pool_ instead of deleting it
+    struct TaskDeleter {
+        TaskPool* pool;
+        void operator()(Task* task) const noexcept { pool->deallocate(task); }
+    };
+    using TaskPtr = std::unique_ptr<Task, TaskDeleter>;
+
+    struct LowerPriority {
+        bool operator()(const Task* a, const Task* b) const {
+            return *a < *b;
+        }
+    };
+
+    // Orders the timer heap so the earliest schedule time is on top
+    struct DueLater {
+        bool operator()(const Task* a, const Task* b) const {
+            return a->schedule_time > b->schedule_time;
+        }
+    };
 
 public:
+    using EventCallback = std::function<void(PoolEvent, size_t thread_count)>;
+
+    // Fixed-size pool
     explicit ThreadPoolExecutor(size_t thread_count = std::thread::hardware_concurrency(),
                               size_t max_queue_size = 10000)
-        : stop_(false), max_queue_size_(max_queue_size), task_pool_(std::make_unique<TaskPool>()) {
-        for (size_t i = 0; i < thread_count; ++i) {
-            workers_.emplace_back([this] { worker_loop(); });
+        : ThreadPoolExecutor(ThreadPoolOptions{
+              .core_threads = thread_count,
+              .max_threads = thread_count,
+              .max_queue_size = max_queue_size}) {}
+
+    explicit ThreadPoolExecutor(const ThreadPoolOptions& options)
+        : stop_(false), timer_waiter_(false),
+          max_queue_size_(options.max_queue_size),
+          core_threads_(options.core_threads),
+          max_threads_(std::max(options.core_threads, options.max_threads)),
+          keep_alive_(options.keep_alive),
+          spawn_latency_threshold_(options.spawn_latency_threshold) {
+        std::unique_lock lock(mutex_);
+        for (size_t i = 0; i < core_threads_; ++i) {
+            spawn_worker_locked();
         }
     }
 
@@ -48,115 +159,515 @@ public:
             stop_ = true;
         }
         condition_.notify_all();
-        for (auto& worker : workers_) {
-            worker.join();
+        space_condition_.notify_all();
+
+        // Nothing spawns or retires once stop_ is set. The loop collects the
+        // live workers together with the handles retired workers moved into
+        // retired_, and repeats until both are empty
+        while (true) {
+            std::vector<std::thread> threads;
+            {
+                std::unique_lock lock(mutex_);
+                for (auto& [id, worker] : workers_) {
+                    threads.push_back(std::move(worker));
+                }
+                workers_.clear();
+                threads.insert(threads.end(), std::make_move_iterator(retired_.begin()),
+                               std::make_move_iterator(retired_.end()));
+                retired_.clear();
+            }
+            if (threads.empty()) {
+                break;
+            }
+            for (auto& worker : threads) {
+                worker.join();
+            }
         }
     }
 
+    // Marks the calling pool thread as blocked for its lifetime. If that
+    // leaves fewer than core_threads runnable workers, a compensating worker
+    // is spawned (up to max_threads). No effect on non-pool threads.
+    class BlockingRegion {
+    public:
+        BlockingRegion() : executor_(current_) {
+            if (executor_) {
+                executor_->enter_blocking();
+            }
+        }
+
+        ~BlockingRegion() {
+            if (executor_) {
+                executor_->leave_blocking();
+            }
+        }
+
+        BlockingRegion(const BlockingRegion&) = delete;
+        BlockingRegion& operator=(const BlockingRegion&) = delete;
+
+    private:
+        ThreadPoolExecutor* executor_;
+    };
+
+    // Runs a blocking call from inside a pool task, see BlockingRegion
+    template<typename F>
+    static decltype(auto) managed_blocking(F&& f) {
+        BlockingRegion region;
+        return std::forward<F>(f)();
+    }
+
+    // Like post(), allocates nothing once warm: the task node comes from
+    // task_pool_ and the future's shared state is recycled. That holds while
+    // the callable and its bound arguments fit in what the task's 16-byte
+    // promise leaves of UniqueFunction::INLINE_SIZE, 48 - 16 = 32 bytes;
+    // larger ones are boxed on the heap by UniqueFunction.
     template<typename F, typename... Args>
     auto submit(F&& f, Args&&... args) {
-        using return_type = std::invoke_result_t<F, Args...>;
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-        std::future<return_type> result = task->get_future();
+        auto [task, result] = package(std::forward<F>(f), std::forward<Args>(args)...);
+        enqueue(std::move(task), 0, std::nullopt);
+        return std::move(result);
+    }
 
+    template<typename F, typename... Args>
+    auto submit_with_priority(int priority, F&& f, Args&&... args) {
+        auto [task, result] = package(std::forward<F>(f), std::forward<Args>(args)...);
+        enqueue(std::move(task), priority, std::nullopt);
+        return std::move(result);
+    }
+
+    template<typename F, typename... Args>
+    auto schedule_after(std::chrono::milliseconds delay, F&& f, Args&&... args) {
+        auto [task, result] = package(std::forward<F>(f), std::forward<Args>(args)...);
+        enqueue(std::move(task), 0,
+                std::chrono::steady_clock::now() + delay);
+        return std::move(result);
+    }
+
+    // Fire-and-forget submission without a future. Callables that fit the
+    // inline buffer of UniqueFunction are stored in a recycled task node, so
+    // steady-state posting performs no heap allocation. Like submit() and
+    // schedule_after(), throws std::runtime_error once the executor is being
+    // destroyed, e.g. when a draining task posts more work.
+    template<typename F>
+    void post(F&& f, int priority = 0) {
+        enqueue(UniqueFunction<void()>(std::forward<F>(f)), priority, std::nullopt);
+    }
+
+    // Never throws on overload and never blocks, whatever the rejection policy
+    template<typename F, typename... Args>
+    auto try_submit(F&& f, Args&&... args)
+        -> SubmitResult<Future<std::invoke_result_t<F, Args...>>> {
+        auto [task, result] = package(std::forward<F>(f), std::forward<Args>(args)...);
+        TaskPtr node = make_task(std::move(task), 0, std::chrono::steady_clock::now());
+        bool spawned = false;
         {
             std::unique_lock lock(mutex_);
-            if (tasks_.size() >= max_queue_size_) {
-                throw std::runtime_error("Task queue is full");
+            if (stop_) {
+                return SubmitError::SHUTDOWN;
             }
-            tasks_.push(task_pool_->allocate(
-                [task]() { (*task)(); }));
+            if (queued_locked() >= max_queue_size_) {
+                ++rejected_;
+                return SubmitError::QUEUE_FULL;
+            }
+            push_ready_locked(std::move(node));
+            spawned = maybe_spawn_locked();
         }
         condition_.notify_one();
-        return result;
+        if (spawned) {
+            emit(PoolEvent::THREAD_SPAWNED);
+        }
+        return std::move(result);
     }
 
-    template<typename F, typename... Args>
-    auto submit_with_priority(int priority, F&& f, Args&&... args) {
-        using return_type = std::invoke_result_t<F, Args...>;
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-        std::future<return_type> result = task->get_future();
+    void set_rejection_policy(RejectionPolicy policy,
+                              std::chrono::milliseconds block_timeout = std::chrono::milliseconds(100)) {
+        std::unique_lock lock(mutex_);
+        policy_ = policy;
+        block_timeout_ = block_timeout;
+    }
+
+    RejectionPolicy rejection_policy() const {
+        std::unique_lock lock(mutex_);
+        return policy_;
+    }
+
+    size_t queue_size() const {
+        std::unique_lock lock(mutex_);
+        return queued_locked();
+    }
+
+    size_t delayed_tasks() const {
+        std::unique_lock lock(mutex_);
+        return delayed_.size();
+    }
+
+    // Largest queue size observed since construction
+    size_t queue_high_water_mark() const {
+        std::unique_lock lock(mutex_);
+        return high_water_mark_;
+    }
+
+    // Tasks refused, dropped or run by the caller because the queue was full
+    size_t rejected_tasks() const {
+        std::unique_lock lock(mutex_);
+        return rejected_;
+    }
 
+    size_t thread_count() const {
+        std::unique_lock lock(mutex_);
+        return live_threads_;
+    }
+
+    PoolStats stats() const {
+        std::unique_lock lock(mutex_);
+        return PoolStats{
+            .thread_count = live_threads_,
+            .idle_threads = idle_threads_,
+            .blocked_threads = blocked_threads_,
+            .spawned = spawned_total_,
+            .retired = retired_total_};
+    }
+
+    // Called outside the executor lock on every spawn and retirement
+    void set_event_callback(EventCallback callback) {
+        std::unique_lock lock(mutex_);
+        event_callback_ = std::move(callback);
+    }
+
+    // Records a span per executed task; nullptr stops recording. The
+    // recorder must outlive the executor or be detached first.
+    void set_tracer(logging::TraceRecorder* tracer) {
+        tracer_.store(tracer, std::memory_order_release);
+    }
+
+private:
+    void spawn_worker_locked() {
+        size_t id = next_worker_id_++;
+        workers_.emplace(id, std::thread([this, id] { worker_loop(id); }));
+        ++live_threads_;
+        ++spawned_total_;
+    }
+
+    // Grows the pool when nobody is idle and the next task has already
+    // waited longer than the spawn threshold
+    bool maybe_spawn_locked() {
+        if (stop_ || idle_threads_ > 0 || live_threads_ >= max_threads_ || tasks_.empty()) {
+            return false;
+        }
+        auto waited = std::chrono::steady_clock::now() - tasks_.front()->schedule_time;
+        if (waited < spawn_latency_threshold_) {
+            return false;
+        }
+        spawn_worker_locked();
+        return true;
+    }
+
+    void emit(PoolEvent event) {
+        EventCallback callback;
+        size_t count;
+        {
+            std::unique_lock lock(mutex_);
+            callback = event_callback_;
+            count = live_threads_;
+        }
+        if (callback) {
+            callback(event, count);
+        }
+    }
+
+    void enter_blocking() {
+        bool spawned = false;
         {
             std::unique_lock lock(mutex_);
-            if (tasks_.size() >= max_queue_size_) {
-                throw std::runtime_error("Task queue is full");
+            ++blocked_threads_;
+            if (!stop_ && live_threads_ - blocked_threads_ < core_threads_ &&
+                live_threads_ < max_threads_) {
+                spawn_worker_locked();
+                spawned = true;
             }
-            tasks_.push(task_pool_->allocate(
-                [task]() { (*task)(); }, priority));
         }
-        condition_.notify_one();
-        return result;
+        if (spawned) {
+            emit(PoolEvent::THREAD_SPAWNED);
+        }
+    }
+
+    // The surplus worker retires through keep_alive once it goes idle
+    void leave_blocking() {
+        std::unique_lock lock(mutex_);
+        --blocked_threads_;
+    }
+
+    bool surplus_locked() const {
+        return live_threads_ - blocked_threads_ > core_threads_;
     }
 
+    // Pairs a runnable task with the future it completes
     template<typename F, typename... Args>
-    auto schedule_after(std::chrono::milliseconds delay, F&& f, Args&&... args) {
+    static auto package(F&& f, Args&&... args) {
         using return_type = std::invoke_result_t<F, Args...>;
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
-        std::future<return_type> result = task->get_future();
+        Promise<return_type> promise;
+        Future<return_type> result = promise.get_future();
+        auto task = [promise = std::move(promise),
+                     func = std::bind(std::forward<F>(f), std::forward<Args>(args)...)]() mutable {
+            detail::fulfil(promise, func);
+        };
+        return std::make_pair(std::move(task), std::move(result));
+    }
+
+    size_t queued_locked() const {
+        return tasks_.size() + delayed_.size();
+    }
+
+    // The node is built before taking the executor lock
+    TaskPtr make_task(UniqueFunction<void()>&& func, int priority,
+                      std::chrono::steady_clock::time_point schedule_time) {
+        return TaskPtr(task_pool_.allocate(std::move(func), priority, schedule_time),
+                       TaskDeleter{&task_pool_});
+    }
 
-        auto schedule_time = std::chrono::steady_clock::now() + delay;
+    void push_ready_locked(TaskPtr node) {
+        node->sequence = next_sequence_++;
+        if (tracer_.load(std::memory_order_relaxed)) {
+            node->ready_at = logging::TraceRecorder::now();
+        }
+        tasks_.push_back(node.release());
+        std::push_heap(tasks_.begin(), tasks_.end(), LowerPriority{});
+        high_water_mark_ = std::max(high_water_mark_, queued_locked());
+    }
+
+    void enqueue(UniqueFunction<void()>&& func, int priority,
+                 std::optional<std::chrono::steady_clock::time_point> schedule_time) {
+        TaskPtr node = make_task(std::move(func), priority,
+                                 schedule_time.value_or(std::chrono::steady_clock::now()));
+        bool notify_all = false;
+        bool spawned = false;
         {
             std::unique_lock lock(mutex_);
-            if (tasks_.size() >= max_queue_size_) {
-                throw std::runtime_error("Task queue is full");
+            // Tasks already queued still run, but nothing new is accepted
+            if (stop_) {
+                throw std::runtime_error("Executor is shutting down");
+            }
+            if (queued_locked() >= max_queue_size_ &&
+                !make_room_locked(lock, schedule_time.has_value())) {
+                lock.unlock();
+                node->func();
+                return;
+            }
+
+            if (!schedule_time) {
+                push_ready_locked(std::move(node));
+                spawned = maybe_spawn_locked();
+            } else {
+                // Only a new earliest deadline changes how long the timer waiter sleeps
+                notify_all = delayed_.empty() || *schedule_time < delayed_.top()->schedule_time;
+                node->sequence = next_sequence_++;
+                delayed_.push(node.release());
+                high_water_mark_ = std::max(high_water_mark_, queued_locked());
             }
-            tasks_.push(task_pool_->allocate(
-                [task]() { (*task)(); }, 0, schedule_time));
         }
-        condition_.notify_one();
-        return result;
+        if (notify_all) {
+            condition_.notify_all();
+        } else if (!schedule_time) {
+            condition_.notify_one();
+        }
+        if (spawned) {
+            emit(PoolEvent::THREAD_SPAWNED);
+        }
     }
 
-    size_t queue_size() const {
-        std::unique_lock lock(mutex_);
-        return tasks_.size();
+    // Applies the rejection policy to a full queue. Returns true once there
+    // is room, false if the caller should run the task itself, and throws if
+    // the task is rejected. A delayed task is never run by the caller, which
+    // would otherwise have to sleep until its schedule time.
+    bool make_room_locked(std::unique_lock<std::mutex>& lock, bool delayed) {
+        ++rejected_;
+        switch (policy_) {
+            case RejectionPolicy::BLOCK:
+                ++blocked_submitters_;
+                space_condition_.wait_for(lock, block_timeout_, [this] {
+                    return stop_ || queued_locked() < max_queue_size_;
+                });
+                --blocked_submitters_;
+                if (!stop_ && queued_locked() < max_queue_size_) {
+                    --rejected_;
+                    return true;
+                }
+                break;
+            case RejectionPolicy::CALLER_RUNS:
+                if (!delayed) {
+                    return false;
+                }
+                break;
+            case RejectionPolicy::DROP_OLDEST:
+                if (!tasks_.empty()) {
+                    drop_oldest_ready_locked();
+                    return true;
+                }
+                break;
+            case RejectionPolicy::THROW:
+                break;
+        }
+        throw std::runtime_error("Task queue is full");
     }
 
-    size_t thread_count() const {
-        return workers_.size();
+    // Destroying the dropped task breaks its promise, so its future fails
+    // with std::future_errc::broken_promise
+    void drop_oldest_ready_locked() {
+        auto oldest = std::min_element(tasks_.begin(), tasks_.end(),
+            [](const Task* a, const Task* b) { return a->sequence < b->sequence; });
+        TaskPtr dropped(*oldest, TaskDeleter{&task_pool_});
+        *oldest = tasks_.back();
+        tasks_.pop_back();
+        std::make_heap(tasks_.begin(), tasks_.end(), LowerPriority{});
     }
 
-private:
-    void worker_loop() {
-        while (true) {
-            std::unique_lock lock(mutex_);
-            condition_.wait(lock, [this] {
-                return stop_ || !tasks_.empty();
-            });
+    // Moves every delayed task whose time has come into the ready queue
+    void promote_due_tasks() {
+        if (delayed_.empty()) {
+            return;
+        }
 
-            if (stop_ && tasks_.empty()) {
-                return;
+        auto now = std::chrono::steady_clock::now();
+        size_t promoted = 0;
+        bool tracing = tracer_.load(std::memory_order_relaxed) != nullptr;
+        while (!delayed_.empty() && delayed_.top()->schedule_time <= now) {
+            if (tracing) {
+                delayed_.top()->ready_at = logging::TraceRecorder::now();
             }
+            tasks_.push_back(delayed_.top());
+            std::push_heap(tasks_.begin(), tasks_.end(), LowerPriority{});
+            delayed_.pop();
+            ++promoted;
+        }
+        if (promoted > 1) {
+            condition_.notify_all();
+        }
+    }
+
+    // At most one idle worker sleeps with a timeout on the earliest delayed
+    // task; the others sleep until notified, so pending timers cost no CPU.
+    void worker_loop(size_t id) {
+        current_ = this;
+        std::unique_lock lock(mutex_);
+        while (true) {
+            promote_due_tasks();
 
-            auto current_time = std::chrono::steady_clock::now();
-            if (!tasks_.empty() && tasks_.top().schedule_time <= current_time) {
-                auto task = std::move(tasks_.top());
-                tasks_.pop();
+            if (!tasks_.empty()) {
+                std::pop_heap(tasks_.begin(), tasks_.end(), LowerPriority{});
+                TaskPtr task(tasks_.back(), TaskDeleter{&task_pool_});
+                tasks_.pop_back();
+                // Hand the timer over to another idle worker while we are busy
+                if (!delayed_.empty() && !timer_waiter_) {
+                    condition_.notify_one();
+                }
+                if (blocked_submitters_ > 0) {
+                    space_condition_.notify_one();
+                }
+                bool spawned = maybe_spawn_locked();
                 lock.unlock();
 
+                if (spawned) {
+                    emit(PoolEvent::THREAD_SPAWNED);
+                }
+
+                logging::TraceRecorder* tracer = tracer_.load(std::memory_order_acquire);
+                uint64_t start = tracer ? logging::TraceRecorder::now() : 0;
                 try {
-                    task.func();
+                    task->func();
                 } catch (...) {
                     // Handle exception
                 }
+                if (tracer) {
+                    // A task queued before the tracer was set has no
+                    // ready_at; its wait is unknown, so it is recorded as none
+                    uint64_t ready = task->ready_at != 0 ? task->ready_at : start;
+                    tracer->record({nullptr, task->sequence, ready,
+                                    start, logging::TraceRecorder::now()});
+                }
+                task.reset();
+
+                lock.lock();
+                if (stop_ && tasks_.empty() && delayed_.empty()) {
+                    condition_.notify_all();
+                }
+                continue;
             }
+
+            if (stop_ && delayed_.empty()) {
+                return;
+            }
+
+            ++idle_threads_;
+            if (!delayed_.empty() && !timer_waiter_) {
+                timer_waiter_ = true;
+                condition_.wait_until(lock, delayed_.top()->schedule_time);
+                timer_waiter_ = false;
+            } else if (surplus_locked()) {
+                auto status = condition_.wait_for(lock, keep_alive_);
+                if (status == std::cv_status::timeout && !stop_ &&
+                    tasks_.empty() && surplus_locked()) {
+                    --idle_threads_;
+                    auto earlier = retire_locked(id);
+                    lock.unlock();
+                    emit(PoolEvent::THREAD_RETIRED);
+                    for (auto& worker : earlier) {
+                        worker.join();
+                    }
+                    return;
+                }
+            } else {
+                condition_.wait(lock);
+            }
+            --idle_threads_;
         }
     }
 
-    std::vector<std::thread> workers_;
-    std::priority_queue<Task> tasks_;
+    // A thread cannot join itself, so a retiring worker parks its handle and
+    // takes over the handles parked before it; it joins those after
+    // releasing the lock. The destructor joins whatever is left.
+    std::vector<std::thread> retire_locked(size_t id) {
+        std::vector<std::thread> earlier = std::move(retired_);
+        retired_.clear();
+
+        auto it = workers_.find(id);
+        retired_.push_back(std::move(it->second));
+        workers_.erase(it);
+        --live_threads_;
+        ++retired_total_;
+        return earlier;
+    }
+
+    inline static thread_local ThreadPoolExecutor* current_ = nullptr;
+
+    std::unordered_map<size_t, std::thread> workers_;
+    std::vector<std::thread> retired_;
+    TaskPool task_pool_;
+    std::vector<Task*> tasks_;   // Binary heap, highest priority first
+    std::priority_queue<Task*, std::vector<Task*>, DueLater> delayed_;
     mutable std::mutex mutex_;
     std::condition_variable condition_;
+    std::condition_variable space_condition_;
     std::atomic<bool> stop_;
+    bool timer_waiter_;
     const size_t max_queue_size_;
-    std::unique_ptr<TaskPool> task_pool_;
+    RejectionPolicy policy_ = RejectionPolicy::THROW;
+    std::chrono::milliseconds block_timeout_{100};
+    size_t blocked_submitters_ = 0;
+    size_t high_water_mark_ = 0;
+    size_t rejected_ = 0;
+    uint64_t next_sequence_ = 0;
+    const size_t core_threads_;
+    const size_t max_threads_;
+    const std::chrono::milliseconds keep_alive_;
+    const std::chrono::microseconds spawn_latency_threshold_;
+    size_t live_threads_ = 0;
+    size_t idle_threads_ = 0;
+    size_t blocked_threads_ = 0;
+    size_t spawned_total_ = 0;
+    size_t retired_total_ = 0;
+    size_t next_worker_id_ = 0;
+    EventCallback event_callback_;
+    std::atomic<logging::TraceRecorder*> tracer_{nullptr};
 };
 
 } // namespace async_toolkit::executor
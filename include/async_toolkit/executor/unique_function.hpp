@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace async_toolkit::executor {
+
+template<typename Signature>
+class UniqueFunction;
+
+// Move-only counterpart of std::function. Accepts move-only callables and
+// stores callables of up to INLINE_SIZE bytes without a heap allocation.
+template<typename R, typename... Args>
+class UniqueFunction<R(Args...)> {
+    static constexpr size_t INLINE_SIZE = 48;
+
+    struct VTable {
+        R (*invoke)(void* storage, Args&&... args);
+        void (*move)(void* dst, void* src) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template<typename F>
+    static constexpr bool stored_inline =
+        sizeof(F) <= INLINE_SIZE &&
+        alignof(F) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<F>;
+
+    template<typename F>
+    static constexpr VTable inline_vtable{
+        [](void* storage, Args&&... args) -> R {
+            return std::invoke(*static_cast<F*>(storage), std::forward<Args>(args)...);
+        },
+        [](void* dst, void* src) noexcept {
+            ::new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        },
+        [](void* storage) noexcept {
+            static_cast<F*>(storage)->~F();
+        }
+    };
+
+    template<typename F>
+    static constexpr VTable heap_vtable{
+        [](void* storage, Args&&... args) -> R {
+            return std::invoke(**static_cast<F**>(storage), std::forward<Args>(args)...);
+        },
+        [](void* dst, void* src) noexcept {
+            *static_cast<F**>(dst) = *static_cast<F**>(src);
+        },
+        [](void* storage) noexcept {
+            delete *static_cast<F**>(storage);
+        }
+    };
+
+public:
+    UniqueFunction() noexcept = default;
+    UniqueFunction(std::nullptr_t) noexcept {}
+
+    template<typename F, typename D = std::decay_t<F>>
+    requires (!std::is_same_v<D, UniqueFunction> && std::is_invocable_r_v<R, D&, Args...>)
+    UniqueFunction(F&& f) {
+        if constexpr (stored_inline<D>) {
+            ::new (static_cast<void*>(storage_)) D(std::forward<F>(f));
+            vtable_ = &inline_vtable<D>;
+        } else {
+            *reinterpret_cast<D**>(storage_) = new D(std::forward<F>(f));
+            vtable_ = &heap_vtable<D>;
+        }
+    }
+
+    UniqueFunction(UniqueFunction&& other) noexcept : vtable_(other.vtable_) {
+        if (vtable_) {
+            vtable_->move(storage_, other.storage_);
+            other.vtable_ = nullptr;
+        }
+    }
+
+    UniqueFunction& operator=(UniqueFunction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.vtable_) {
+                other.vtable_->move(storage_, other.storage_);
+                vtable_ = other.vtable_;
+                other.vtable_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    UniqueFunction(const UniqueFunction&) = delete;
+    UniqueFunction& operator=(const UniqueFunction&) = delete;
+
+    ~UniqueFunction() {
+        reset();
+    }
+
+    R operator()(Args... args) {
+        if (!vtable_) {
+            throw std::bad_function_call();
+        }
+        return vtable_->invoke(storage_, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept { return vtable_ != nullptr; }
+
+private:
+    void reset() noexcept {
+        if (vtable_) {
+            vtable_->destroy(storage_);
+            vtable_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) std::byte storage_[INLINE_SIZE];
+    const VTable* vtable_ = nullptr;
+};
+
+} // namespace async_toolkit::executor
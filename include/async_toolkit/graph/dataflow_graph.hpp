@@ -0,0 +1,354 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "../executor/future.hpp"
+
+namespace async_toolkit::graph {
+
+// Task graph whose nodes may return different types and receive their
+// predecessors' outputs as arguments. Each result lives inside its node;
+// consumers get a const reference to it, or an rvalue reference when the
+// edge was declared with consume(), which requires the producer to have no
+// other consumer.
+//
+//   DataflowGraph graph;
+//   auto text = graph.emplace([] { return load(); });
+//   auto words = graph.emplace([](std::string s) { return split(std::move(s)); },
+//                              graph.consume(text));
+//   auto count = graph.emplace([](const auto& w) { return w.size(); }, words);
+//   graph.run(pool);
+//   size_t n = graph.result(count);
+class DataflowGraph {
+    class NodeBase;
+
+    template<typename T>
+    class Node;
+
+public:
+    template<typename T>
+    class Handle {
+    public:
+        Handle() = default;
+
+    private:
+        friend class DataflowGraph;
+        explicit Handle(Node<T>* node) : node_(node) {}
+        Node<T>* node_ = nullptr;
+    };
+
+    // Edge marker that moves the producer's value into its single consumer
+    template<typename T>
+    class Consume {
+    private:
+        friend class DataflowGraph;
+        explicit Consume(Node<T>* node) : node_(node) {}
+        Node<T>* node_;
+    };
+
+    DataflowGraph() = default;
+    DataflowGraph(const DataflowGraph&) = delete;
+    DataflowGraph& operator=(const DataflowGraph&) = delete;
+
+    // Adds a node that runs func with the outputs of inputs (Handles or
+    // Consume markers) once they are all available
+    template<typename F, typename... Inputs>
+    auto emplace(F&& func, Inputs... inputs) {
+        using R = std::invoke_result_t<std::decay_t<F>&, input_t<Inputs>...>;
+        (check_owner(inputs.node_), ...);
+        auto node = std::make_unique<TaskNode<R, std::decay_t<F>, Inputs...>>(
+            this, std::forward<F>(func), inputs...);
+        (link(node.get(), inputs), ...);
+        Handle<R> handle(node.get());
+        nodes_.push_back(std::move(node));
+        return handle;
+    }
+
+    template<typename T>
+    Consume<T> consume(Handle<T> handle) const {
+        check_owner(handle.node_);
+        return Consume<T>(handle.node_);
+    }
+
+    // Ordering-only edge for nodes that do not need each other's output
+    template<typename T, typename U>
+    void add_dependency(Handle<T> dependent, Handle<U> dependency) {
+        check_owner(dependent.node_);
+        check_owner(dependency.node_);
+        dependency.node_->successors_.push_back(dependent.node_);
+        ++dependent.node_->dependencies_;
+    }
+
+    // Runs every node once and blocks until the graph is done. Values from
+    // the previous run are discarded first. The first exception thrown by a
+    // node is rethrown; nodes downstream of it are skipped.
+    template<executor::Executor E>
+    void run(E& executor) {
+        if (running_.exchange(true, std::memory_order_acquire)) {
+            throw std::logic_error("DataflowGraph is already running");
+        }
+        try {
+            prepare();
+        } catch (...) {
+            running_.store(false, std::memory_order_release);
+            throw;
+        }
+
+        if (!nodes_.empty()) {
+            for (const auto& node : nodes_) {
+                if (node->dependencies_ == 0) {
+                    dispatch(executor, node.get());
+                }
+            }
+            std::unique_lock lock(done_mutex_);
+            done_condition_.wait(lock, [this] { return done_; });
+        }
+        running_.store(false, std::memory_order_release);
+
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    // Output of a node from the last run
+    template<typename T>
+    requires (!std::is_void_v<T>)
+    T& result(Handle<T> handle) {
+        check_owner(handle.node_);
+        if (handle.node_->consumed_) {
+            throw std::logic_error("DataflowGraph result was moved into its consumer");
+        }
+        if (!handle.node_->value_) {
+            throw std::runtime_error("DataflowGraph node has not produced a value");
+        }
+        return *handle.node_->value_;
+    }
+
+    size_t size() const { return nodes_.size(); }
+
+private:
+    class NodeBase {
+    public:
+        explicit NodeBase(const DataflowGraph* owner) : owner_(owner) {}
+        virtual ~NodeBase() = default;
+
+        virtual void invoke() = 0;
+        virtual void reset() = 0;
+
+        const DataflowGraph* owner_;
+        std::vector<NodeBase*> successors_;
+        size_t dependencies_ = 0;
+        size_t consumers_ = 0;
+        bool consumed_ = false;
+        std::atomic<size_t> pending_{0};
+        NodeBase* next_ready_ = nullptr;   // Worklist link, see execute()
+    };
+
+    template<typename T>
+    class Node : public NodeBase {
+    public:
+        using NodeBase::NodeBase;
+
+        void reset() override {
+            if constexpr (!std::is_void_v<T>) {
+                value_.reset();
+            }
+        }
+
+        std::conditional_t<std::is_void_v<T>, std::monostate, std::optional<T>> value_;
+    };
+
+    template<typename R, typename F, typename... Inputs>
+    class TaskNode final : public Node<R> {
+    public:
+        template<typename G>
+        TaskNode(const DataflowGraph* owner, G&& func, Inputs... inputs)
+            : Node<R>(owner), func_(std::forward<G>(func)), inputs_(inputs...) {}
+
+        void invoke() override {
+            std::apply([this](auto&... inputs) {
+                if constexpr (std::is_void_v<R>) {
+                    std::invoke(func_, fetch(inputs)...);
+                } else {
+                    this->value_.emplace(std::invoke(func_, fetch(inputs)...));
+                }
+            }, inputs_);
+        }
+
+    private:
+        F func_;
+        std::tuple<Inputs...> inputs_;
+    };
+
+    template<typename Input>
+    struct input_traits;
+
+    template<typename T>
+    struct input_traits<Handle<T>> {
+        static_assert(!std::is_void_v<T>, "void nodes can only be ordered with add_dependency");
+        using type = const T&;
+    };
+
+    template<typename T>
+    struct input_traits<Consume<T>> {
+        static_assert(!std::is_void_v<T>, "void nodes can only be ordered with add_dependency");
+        using type = T&&;
+    };
+
+    template<typename Input>
+    using input_t = typename input_traits<Input>::type;
+
+    template<typename T>
+    static const T& fetch(const Handle<T>& input) {
+        return *input.node_->value_;
+    }
+
+    template<typename T>
+    static T&& fetch(const Consume<T>& input) {
+        return std::move(*input.node_->value_);
+    }
+
+    void check_owner(const NodeBase* node) const {
+        if (!node || node->owner_ != this) {
+            throw std::logic_error("DataflowGraph handle does not belong to this graph");
+        }
+    }
+
+    template<typename T>
+    static void link(NodeBase* consumer, const Handle<T>& input) {
+        input.node_->successors_.push_back(consumer);
+        ++input.node_->consumers_;
+        ++consumer->dependencies_;
+    }
+
+    template<typename T>
+    static void link(NodeBase* consumer, const Consume<T>& input) {
+        link(consumer, Handle<T>(input.node_));
+        input.node_->consumed_ = true;
+    }
+
+    // Validates consume() edges and the absence of cycles, then resets the
+    // per-run state
+    void prepare() {
+        for (const auto& node : nodes_) {
+            if (node->consumed_ && node->consumers_ != 1) {
+                throw std::logic_error("DataflowGraph consumed value has more than one consumer");
+            }
+        }
+
+        std::vector<NodeBase*> ready;
+        ready.reserve(nodes_.size());
+        for (const auto& node : nodes_) {
+            node->pending_.store(node->dependencies_, std::memory_order_relaxed);
+            if (node->dependencies_ == 0) {
+                ready.push_back(node.get());
+            }
+        }
+        for (size_t i = 0; i < ready.size(); ++i) {
+            for (NodeBase* successor : ready[i]->successors_) {
+                if (successor->pending_.fetch_sub(1, std::memory_order_relaxed) == 1) {
+                    ready.push_back(successor);
+                }
+            }
+        }
+        if (ready.size() != nodes_.size()) {
+            throw std::logic_error("DataflowGraph contains a dependency cycle");
+        }
+
+        for (const auto& node : nodes_) {
+            node->reset();
+            node->pending_.store(node->dependencies_, std::memory_order_relaxed);
+        }
+        remaining_.store(nodes_.size(), std::memory_order_relaxed);
+        failed_.store(false, std::memory_order_relaxed);
+        error_ = nullptr;
+        done_ = false;
+    }
+
+    template<typename E>
+    void dispatch(E& executor, NodeBase* node) {
+        executor.post([this, &executor, node] { execute(executor, node); });
+    }
+
+    // Nodes made ready on a thread that is already running one of this
+    // graph's nodes, linked through next_ready_. When post() runs inline,
+    // the nested execute() only pushes its node and the outer frame drains
+    // the list, so a chain costs constant stack instead of a frame per edge.
+    struct Worklist {
+        const DataflowGraph* graph;
+        NodeBase* head;
+        Worklist* outer;
+    };
+
+    template<typename E>
+    void execute(E& executor, NodeBase* node) {
+        if (worklist_ && worklist_->graph == this) {
+            node->next_ready_ = worklist_->head;
+            worklist_->head = node;
+            return;
+        }
+        Worklist local{this, nullptr, worklist_};
+        worklist_ = &local;
+        struct Restore {
+            Worklist* outer;
+            ~Restore() { worklist_ = outer; }
+        } restore{local.outer};
+
+        execute_node(executor, node);
+        while (local.head) {
+            NodeBase* next = local.head;
+            local.head = next->next_ready_;
+            execute_node(executor, next);
+        }
+    }
+
+    template<typename E>
+    void execute_node(E& executor, NodeBase* node) {
+        if (!failed_.load(std::memory_order_relaxed)) {
+            try {
+                node->invoke();
+            } catch (...) {
+                std::lock_guard lock(done_mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                failed_.store(true, std::memory_order_relaxed);
+            }
+        }
+        for (NodeBase* successor : node->successors_) {
+            if (successor->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                dispatch(executor, successor);
+            }
+        }
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard lock(done_mutex_);
+            done_ = true;
+            done_condition_.notify_one();
+        }
+    }
+
+    static inline thread_local Worklist* worklist_ = nullptr;
+
+    std::vector<std::unique_ptr<NodeBase>> nodes_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> remaining_{0};
+    std::atomic<bool> failed_{false};
+    std::mutex done_mutex_;
+    std::condition_variable done_condition_;
+    bool done_ = false;
+    std::exception_ptr error_;
+};
+
+} // namespace async_toolkit::graph
@@ -1,15 +1,32 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 #include <memory>
 #include <functional>
-#include <future>
-#include "../task_pool.hpp"
+#include <span>
+#include <string>
+#include "../coroutine/task_pool.hpp"
+#include "../logging/trace.hpp"
 
 namespace async_toolkit::graph {
 
+template<typename T>
+class CompiledTaskGraph;
+
+// Order in which a compiled graph starts nodes that became ready together
+enum class ReadyOrder {
+    FIFO,           // hand ready nodes to the executor as they are released
+    CRITICAL_PATH   // highest upward rank (longest remaining path) first
+};
+
 template<typename T>
 class TaskGraph {
 public:
@@ -17,13 +34,25 @@ public:
     using NodePtr = std::shared_ptr<Node>;
     using NodeWeakPtr = std::weak_ptr<Node>;
 
+    // A subflow node receives an empty graph to fill in while it runs; the
+    // spawned nodes execute on the same pool and the node's successors are
+    // released only once all of them have finished.
+    using Subflow = TaskGraph;
+
     class Node {
     public:
-        explicit Node(std::function<T()> task)
-            : task_(std::move(task)), executed_(false) {}
+        explicit Node(std::function<T()> task, double cost = 1.0)
+            : task_(std::move(task)), cost_(cost), executed_(false) {}
 
+        // Edges out of a condition node are weak: they do not count towards
+        // this node's dependencies and may point backwards to form loops
         void add_dependency(NodePtr node) {
-            dependencies_.push_back(node);
+            node->successors_.push_back(this);
+            if (node->is_condition()) {
+                ++weak_dependencies_;
+            } else {
+                dependencies_.push_back(std::move(node));
+            }
         }
 
         bool can_execute() const {
@@ -32,29 +61,78 @@ public:
                     return false;
                 }
             }
-            return !executed_;
+            return !is_executed();
         }
 
         T execute() {
-            if (!executed_) {
+            if (!is_executed()) {
                 result_ = task_();
-                executed_ = true;
+                executed_.store(true, std::memory_order_release);
             }
             return result_;
         }
 
-        bool is_executed() const { return executed_; }
+        bool is_executed() const { return executed_.load(std::memory_order_acquire); }
+        bool is_condition() const { return static_cast<bool>(condition_); }
         const T& get_result() const { return result_; }
 
+        // Label shown for this node in execution traces
+        void set_name(std::string name) { name_ = std::move(name); }
+        const std::string& name() const { return name_; }
+
     private:
+        friend class TaskGraph;
+        friend class CompiledTaskGraph<T>;
+
         std::function<T()> task_;
+        std::function<size_t()> condition_;
+        std::function<T(Subflow&)> spawn_;
+        std::unique_ptr<Subflow> subflow_;
+        std::string name_;
+        double cost_;
         std::vector<NodePtr> dependencies_;
-        bool executed_;
+        size_t weak_dependencies_ = 0;
+        std::vector<Node*> successors_;
+        std::atomic<size_t> pending_{0};
+        std::atomic<bool> executed_;
         T result_;
     };
 
-    NodePtr add_task(std::function<T()> task) {
-        auto node = std::make_shared<Node>(std::move(task));
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+    TaskGraph(TaskGraph&&) = default;
+    TaskGraph& operator=(TaskGraph&&) = default;
+
+    // Every node is still owned by nodes_, so dropping the dependency edges
+    // first keeps a long chain from being destroyed one nested frame per node
+    ~TaskGraph() {
+        for (const auto& node : nodes_) {
+            node->dependencies_.clear();
+        }
+    }
+
+    // cost is a relative estimate of the task's run time, only used to rank
+    // nodes for ReadyOrder::CRITICAL_PATH
+    NodePtr add_task(std::function<T()> task, double cost = 1.0) {
+        auto node = std::make_shared<Node>(std::move(task), cost);
+        nodes_.push_back(node);
+        return node;
+    }
+
+    // The returned index selects which successor runs next, in the order the
+    // successors were attached with add_dependency; an out-of-range index
+    // runs none of them. Pointing a branch at an earlier node forms a loop.
+    NodePtr add_condition(std::function<size_t()> condition) {
+        auto node = std::make_shared<Node>(nullptr);
+        node->condition_ = std::move(condition);
+        nodes_.push_back(node);
+        return node;
+    }
+
+    NodePtr add_subflow(std::function<T(Subflow&)> spawn) {
+        auto node = std::make_shared<Node>(nullptr);
+        node->spawn_ = std::move(spawn);
         nodes_.push_back(node);
         return node;
     }
@@ -63,33 +141,564 @@ public:
         dependent->add_dependency(dependency);
     }
 
+    // Records a span per executed node, including nodes spawned by subflows;
+    // nullptr (the default) turns recording off
+    void set_tracer(logging::TraceRecorder* tracer) {
+        tracer_ = tracer;
+    }
+
+    // Runs the graph and returns the results in insertion order. Each
+    // finishing node releases its successors directly, so scheduling costs
+    // O(V + E) and the caller sleeps until nothing is left in flight. Nodes
+    // with no incoming edge, strong or weak, start the run, and a non-empty
+    // graph without one throws std::logic_error. Nodes a condition never
+    // selects keep a default result, nodes in a loop keep their last one.
+    // The first exception thrown by a node is rethrown here and nothing
+    // further is started after it.
     std::vector<T> execute(TaskPool& pool) {
-        std::vector<std::future<T>> futures;
-        std::unordered_set<NodePtr> completed;
-        
-        while (completed.size() < nodes_.size()) {
-            for (const auto& node : nodes_) {
-                if (completed.count(node) == 0 && node->can_execute()) {
-                    futures.push_back(pool.submit([node]() {
-                        return node->execute();
-                    }));
-                    completed.insert(node);
+        return execute_async(pool).get();
+    }
+
+    // Starts the graph and returns at once; the future completes on the
+    // thread that finishes the last node, with the results or the first
+    // exception a node threw. Structural errors still throw here. The graph
+    // must stay alive and unchanged until the future is ready.
+    executor::Future<std::vector<T>> execute_async(TaskPool& pool) {
+        topological_order();
+        if (nodes_.empty()) {
+            return executor::make_ready_future(std::vector<T>{});
+        }
+
+        auto* run = new Run(pool);
+        run->tracer = tracer_;
+        run->graph = this;
+        auto done = run->promise.get_future();
+        try {
+            start(*run);
+        } catch (...) {
+            // start() only throws before it schedules anything
+            delete run;
+            throw;
+        }
+        return done;
+    }
+
+    // Freezes the current shape into a graph that can be run repeatedly.
+    // Condition and subflow nodes are only supported by execute().
+    CompiledTaskGraph<T> compile() const;
+
+private:
+    friend class CompiledTaskGraph<T>;
+
+    // State of one graph execution. The top-level run owns the error state
+    // and completes the caller's future; every subflow gets a run of its own
+    // that releases its parent node when its last task finishes. All runs
+    // are heap-allocated and delete themselves when their last task ends.
+    struct Run {
+        explicit Run(TaskPool& p, Run* parent_run = nullptr, Node* node = nullptr)
+            : pool(p), root(parent_run ? parent_run->root : this),
+              parent(parent_run), parent_node(node),
+              tracer(parent_run ? parent_run->tracer : nullptr) {}
+
+        TaskPool& pool;
+        Run* root;
+        Run* parent;
+        Node* parent_node;
+        logging::TraceRecorder* tracer;
+        std::atomic<size_t> in_flight{0};
+
+        // Only used on the root run
+        std::atomic<bool> failed{false};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+        const TaskGraph* graph = nullptr;
+        executor::Promise<std::vector<T>> promise;
+    };
+
+    // Schedules every node without incoming edges; false for an empty graph.
+    // Throws if every node has one: a node reached only through a condition
+    // is not a root, so a loop needs an entry task in front of its body.
+    bool start(Run& run) {
+        if (nodes_.empty()) {
+            return false;
+        }
+        bool has_root = false;
+        for (const auto& node : nodes_) {
+            node->pending_.store(node->dependencies_.size(), std::memory_order_relaxed);
+            has_root = has_root || (node->dependencies_.empty() && node->weak_dependencies_ == 0);
+        }
+        if (!has_root) {
+            throw std::logic_error("TaskGraph has no node without incoming edges to start from");
+        }
+        // Hold one reference so the run cannot finish while roots are posted
+        run.in_flight.store(1, std::memory_order_relaxed);
+        uint64_t now = run.tracer ? logging::TraceRecorder::now() : 0;
+        for (const auto& node : nodes_) {
+            if (node->dependencies_.empty() && node->weak_dependencies_ == 0) {
+                schedule(run, node.get(), now);
+            }
+        }
+        finish(run);
+        return true;
+    }
+
+    // released is the trace timestamp at which node became ready
+    static void schedule(Run& run, Node* node, uint64_t released) {
+        run.in_flight.fetch_add(1, std::memory_order_relaxed);
+        run.pool.post([&run, node, released] { invoke(run, node, released); });
+    }
+
+    static void invoke(Run& run, Node* node, uint64_t released) {
+        // Re-arm the counter so a loop can release this node again
+        node->pending_.store(node->dependencies_.size(), std::memory_order_relaxed);
+        uint64_t started = run.tracer ? logging::TraceRecorder::now() : 0;
+        uint64_t finished = 0;
+        bool traced = false;
+
+        size_t branch = 0;
+        // Nodes released before a failure was seen are skipped, not traced
+        bool skipped = run.root->failed.load(std::memory_order_relaxed);
+        if (!skipped) {
+            try {
+                if (node->condition_) {
+                    branch = node->condition_();
+                } else if (node->spawn_) {
+                    node->subflow_ = std::make_unique<Subflow>();
+                    node->result_ = node->spawn_(*node->subflow_);
+                    node->executed_.store(true, std::memory_order_release);
+                    // The span covers the spawning callback; the spawned
+                    // nodes are recorded on their own
+                    trace(run, node, released, started);
+                    traced = true;
+                    node->subflow_->topological_order();
+                    auto child = std::make_unique<Run>(run.pool, &run, node);
+                    if (node->subflow_->start(*child)) {
+                        // The child run releases this node's successors
+                        child.release();
+                        return;
+                    }
+                } else {
+                    node->result_ = node->task_();
+                    node->executed_.store(true, std::memory_order_release);
                 }
+            } catch (...) {
+                fail(run);
             }
         }
+        // Record before releasing: once the run finishes the graph may go away
+        if (!traced && !skipped) {
+            finished = trace(run, node, released, started);
+        }
+        release(run, node, branch, finished);
+        finish(run);
+    }
 
-        std::vector<T> results;
-        results.reserve(futures.size());
-        for (auto& future : futures) {
-            results.push_back(future.get());
+    // Returns the span's end, which doubles as the release time of the
+    // successors so a traced node costs two clock reads. A subflow's nodes
+    // are destroyed when its node runs again, so their names are copied
+    // into the recorder.
+    static uint64_t trace(Run& run, const Node* node, uint64_t released, uint64_t started) {
+        if (!run.tracer) {
+            return 0;
         }
-        return results;
+        uint64_t finished = logging::TraceRecorder::now();
+        const char* name = nullptr;
+        if (!node->name_.empty()) {
+            name = run.parent ? run.tracer->intern(node->name_) : node->name_.c_str();
+        }
+        run.tracer->record({name, reinterpret_cast<uintptr_t>(node), released, started, finished});
+        return finished;
+    }
+
+    static void release(Run& run, Node* node, size_t branch, uint64_t now) {
+        if (run.root->failed.load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (node->condition_) {
+            if (branch < node->successors_.size()) {
+                schedule(run, node->successors_[branch], now);
+            }
+            return;
+        }
+        for (Node* successor : node->successors_) {
+            if (successor->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                schedule(run, successor, now);
+            }
+        }
+    }
+
+    static void finish(Run& run) {
+        if (run.in_flight.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        if (run.parent) {
+            Run* parent = run.parent;
+            Node* node = run.parent_node;
+            delete &run;
+            release(*parent, node, 0, parent->tracer ? logging::TraceRecorder::now() : 0);
+            finish(*parent);
+        } else {
+            // The caller may tear down the graph as soon as the promise is
+            // set, so the results are collected and the run deleted first
+            auto promise = std::move(run.promise);
+            std::exception_ptr error = run.error;
+            std::vector<T> results;
+            if (!error) {
+                results.reserve(run.graph->nodes_.size());
+                for (const auto& node : run.graph->nodes_) {
+                    results.push_back(node->get_result());
+                }
+            }
+            delete &run;
+            if (error) {
+                promise.set_exception(error);
+            } else {
+                promise.set_value(std::move(results));
+            }
+        }
+    }
+
+    static void fail(Run& run) {
+        Run& root = *run.root;
+        std::lock_guard lock(root.error_mutex);
+        if (!root.error) {
+            root.error = std::current_exception();
+        }
+        root.failed.store(true, std::memory_order_relaxed);
+    }
+
+    // Kahn's algorithm over the strong edges; anything left unvisited sits on
+    // a cycle and would never become ready. Weak edges out of condition nodes
+    // are skipped, so loops through a condition are allowed.
+    std::vector<const Node*> topological_order() const {
+        std::unordered_map<const Node*, size_t> indegree;
+        indegree.reserve(nodes_.size());
+        for (const auto& node : nodes_) {
+            indegree.emplace(node.get(), node->dependencies_.size());
+        }
+
+        std::vector<const Node*> order;
+        order.reserve(nodes_.size());
+        for (const auto& node : nodes_) {
+            for (const auto& dep : node->dependencies_) {
+                if (!indegree.count(dep.get())) {
+                    throw std::logic_error("TaskGraph dependency is not part of this graph");
+                }
+            }
+            if (node->dependencies_.empty()) {
+                order.push_back(node.get());
+            }
+        }
+
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (order[i]->is_condition()) {
+                continue;
+            }
+            for (const Node* successor : order[i]->successors_) {
+                if (--indegree[successor] == 0) {
+                    order.push_back(successor);
+                }
+            }
+        }
+
+        if (order.size() != nodes_.size()) {
+            throw std::logic_error("TaskGraph contains a dependency cycle");
+        }
+        return order;
     }
 
-private:
     std::vector<NodePtr> nodes_;
+    logging::TraceRecorder* tracer_ = nullptr;
 };
 
+// Immutable snapshot of a TaskGraph: slots in topological order with
+// successor lists packed into one array and each slot's upward rank (its
+// cost plus the most expensive path below it). Everything run() touches is
+// allocated by compile(), so a graph can be re-run thousands of times per
+// second; with a ThreadPoolExecutor (pooled task nodes) a run performs no
+// heap allocation at all. Inputs are passed through state the tasks
+// capture by reference. A compiled graph must not be run concurrently
+// with itself.
+template<typename T>
+class CompiledTaskGraph {
+public:
+    CompiledTaskGraph(const CompiledTaskGraph&) = delete;
+    CompiledTaskGraph& operator=(const CompiledTaskGraph&) = delete;
+
+    // Runs the graph to completion and returns the results in the order the
+    // tasks were added to the source graph. The span stays valid until the
+    // next run. With CRITICAL_PATH, ready slots wait in a rank-ordered heap
+    // and every task posted to the executor runs whichever ready slot has
+    // the longest path ahead of it, so long chains start first.
+    template<executor::Executor E>
+    std::span<const T> run(E& executor, ReadyOrder order = ReadyOrder::FIFO) {
+        if (running_.exchange(true, std::memory_order_acquire)) {
+            throw std::logic_error("CompiledTaskGraph is already running");
+        }
+        if (slots_.empty()) {
+            running_.store(false, std::memory_order_release);
+            return {};
+        }
+
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            pending_[i].store(slots_[i].dependencies, std::memory_order_relaxed);
+        }
+        remaining_.store(slots_.size(), std::memory_order_relaxed);
+        failed_.store(false, std::memory_order_relaxed);
+        error_ = nullptr;
+        done_ = false;
+        order_ = order;
+
+        if (tracer_) {
+            std::fill_n(released_.get(), root_count_, logging::TraceRecorder::now());
+        }
+        if (order_ == ReadyOrder::CRITICAL_PATH) {
+            {
+                std::lock_guard lock(ready_mutex_);
+                for (uint32_t slot = 0; slot < root_count_; ++slot) {
+                    push_ready(slot);
+                }
+            }
+            for (uint32_t slot = 0; slot < root_count_; ++slot) {
+                executor.post([this, &executor] { execute(executor, pop_ready()); });
+            }
+        } else {
+            for (uint32_t slot = 0; slot < root_count_; ++slot) {
+                dispatch(executor, slot);
+            }
+        }
+        {
+            std::unique_lock lock(done_mutex_);
+            done_condition_.wait(lock, [this] { return done_; });
+        }
+        running_.store(false, std::memory_order_release);
+
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        return {results_.get(), slots_.size()};
+    }
+
+    size_t size() const { return slots_.size(); }
+
+    // Total cost of the most expensive chain, a lower bound on the makespan
+    double critical_path() const { return critical_path_; }
+
+    // Records a span per executed slot; set between runs, nullptr disables
+    void set_tracer(logging::TraceRecorder* tracer) { tracer_ = tracer; }
+
+private:
+    friend class TaskGraph<T>;
+
+    struct Slot {
+        std::function<T()> task;
+        std::string name;
+        double rank;
+        uint32_t first_successor;
+        uint32_t last_successor;
+        uint32_t dependencies;
+        uint32_t output;
+    };
+
+    explicit CompiledTaskGraph(const TaskGraph<T>& graph) {
+        using Node = typename TaskGraph<T>::Node;
+
+        auto order = graph.topological_order();
+        for (const Node* node : order) {
+            if (node->condition_ || node->spawn_) {
+                throw std::logic_error("CompiledTaskGraph does not support condition or subflow nodes");
+            }
+        }
+        std::unordered_map<const Node*, uint32_t> position;
+        std::unordered_map<const Node*, uint32_t> output;
+        position.reserve(order.size());
+        output.reserve(order.size());
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            position.emplace(order[i], i);
+        }
+        for (uint32_t i = 0; i < graph.nodes_.size(); ++i) {
+            output.emplace(graph.nodes_[i].get(), i);
+        }
+
+        slots_.reserve(order.size());
+        for (const Node* node : order) {
+            Slot slot{node->task_, node->name_, node->cost_,
+                      static_cast<uint32_t>(successors_.size()), 0,
+                      static_cast<uint32_t>(node->dependencies_.size()),
+                      output[node]};
+            for (const Node* successor : node->successors_) {
+                successors_.push_back(position[successor]);
+            }
+            slot.last_successor = static_cast<uint32_t>(successors_.size());
+            if (slot.dependencies == 0) {
+                ++root_count_;
+            }
+            slots_.push_back(std::move(slot));
+        }
+
+        // Successors sit later in topological order, so one backwards sweep
+        // sees every successor's final rank
+        for (size_t i = slots_.size(); i-- > 0;) {
+            Slot& slot = slots_[i];
+            double longest = 0.0;
+            for (uint32_t j = slot.first_successor; j < slot.last_successor; ++j) {
+                longest = std::max(longest, slots_[successors_[j]].rank);
+            }
+            slot.rank += longest;
+            critical_path_ = std::max(critical_path_, slot.rank);
+        }
+
+        pending_ = std::make_unique<std::atomic<uint32_t>[]>(slots_.size());
+        results_ = std::make_unique<T[]>(slots_.size());
+        released_ = std::make_unique<uint64_t[]>(slots_.size());
+        next_ready_ = std::make_unique<uint32_t[]>(slots_.size());
+        ready_.reserve(slots_.size());
+    }
+
+    template<typename E>
+    void dispatch(E& executor, uint32_t index) {
+        executor.post([this, &executor, index] { execute(executor, index); });
+    }
+
+    template<typename E>
+    void release(E& executor, uint32_t index) {
+        if (order_ == ReadyOrder::CRITICAL_PATH) {
+            {
+                std::lock_guard lock(ready_mutex_);
+                push_ready(index);
+            }
+            executor.post([this, &executor] { execute(executor, pop_ready()); });
+        } else {
+            dispatch(executor, index);
+        }
+    }
+
+    // ready_ is reserved for every slot at compile time, so these never
+    // allocate; one posted task exists per pushed slot, so pops never miss
+    void push_ready(uint32_t index) {
+        ready_.push_back(index);
+        std::push_heap(ready_.begin(), ready_.end(), [this](uint32_t a, uint32_t b) {
+            return slots_[a].rank < slots_[b].rank;
+        });
+    }
+
+    uint32_t pop_ready() {
+        std::lock_guard lock(ready_mutex_);
+        std::pop_heap(ready_.begin(), ready_.end(), [this](uint32_t a, uint32_t b) {
+            return slots_[a].rank < slots_[b].rank;
+        });
+        uint32_t index = ready_.back();
+        ready_.pop_back();
+        return index;
+    }
+
+    // Slots made ready on a thread that is already executing one of this
+    // graph's slots, linked through next_ready_. With an executor whose
+    // post() runs inline, the nested execute() only pushes its slot here and
+    // the outer frame drains the list, so a chain costs constant stack
+    // instead of one frame per edge. Each slot is ready once per run, so the
+    // intrusive links never allocate.
+    struct Worklist {
+        const CompiledTaskGraph* graph;
+        uint32_t head;
+        Worklist* outer;
+    };
+
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    template<typename E>
+    void execute(E& executor, uint32_t index) {
+        if (worklist_ && worklist_->graph == this) {
+            next_ready_[index] = worklist_->head;
+            worklist_->head = index;
+            return;
+        }
+        Worklist local{this, NO_SLOT, worklist_};
+        worklist_ = &local;
+        struct Restore {
+            Worklist* outer;
+            ~Restore() { worklist_ = outer; }
+        } restore{local.outer};
+
+        execute_slot(executor, index);
+        while (local.head != NO_SLOT) {
+            uint32_t next = local.head;
+            local.head = next_ready_[next];
+            execute_slot(executor, next);
+        }
+    }
+
+    template<typename E>
+    void execute_slot(E& executor, uint32_t index) {
+        const Slot& slot = slots_[index];
+        uint64_t started = tracer_ ? logging::TraceRecorder::now() : 0;
+        bool skipped = failed_.load(std::memory_order_relaxed);
+        if (!skipped) {
+            try {
+                results_[slot.output] = slot.task();
+            } catch (...) {
+                std::lock_guard lock(done_mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                failed_.store(true, std::memory_order_relaxed);
+            }
+        }
+        // The span's end doubles as the successors' release time, so a
+        // traced slot costs two clock reads
+        uint64_t finished = 0;
+        if (tracer_ && !skipped) {
+            finished = logging::TraceRecorder::now();
+            tracer_->record({slot.name.empty() ? nullptr : slot.name.c_str(), slot.output,
+                             released_[index], started, finished});
+        }
+        for (uint32_t i = slot.first_successor; i < slot.last_successor; ++i) {
+            uint32_t successor = successors_[i];
+            if (pending_[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                if (tracer_) {
+                    released_[successor] = finished;
+                }
+                release(executor, successor);
+            }
+        }
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard lock(done_mutex_);
+            done_ = true;
+            done_condition_.notify_one();
+        }
+    }
+
+    // Roots come first in topological order, so they are slots [0, root_count_)
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> successors_;
+    uint32_t root_count_ = 0;
+    std::unique_ptr<std::atomic<uint32_t>[]> pending_;
+    std::unique_ptr<T[]> results_;
+    std::unique_ptr<uint64_t[]> released_;   // Per-slot release time, traced runs only
+    std::unique_ptr<uint32_t[]> next_ready_; // Worklist links, see execute()
+    double critical_path_ = 0.0;
+    logging::TraceRecorder* tracer_ = nullptr;
+
+    static inline thread_local Worklist* worklist_ = nullptr;
+
+    ReadyOrder order_ = ReadyOrder::FIFO;
+    std::mutex ready_mutex_;
+    std::vector<uint32_t> ready_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<size_t> remaining_{0};
+    std::atomic<bool> failed_{false};
+    std::mutex done_mutex_;
+    std::condition_variable done_condition_;
+    bool done_ = false;
+    std::exception_ptr error_;
+};
+
+template<typename T>
+CompiledTaskGraph<T> TaskGraph<T>::compile() const {
+    return CompiledTaskGraph<T>(*this);
+}
+
 // Helper function to create a task graph
 template<typename T>
 auto make_task_graph() {
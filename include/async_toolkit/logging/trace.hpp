@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace async_toolkit::logging {
+
+// One executed task. Timestamps come from TraceRecorder::now(); enqueue is
+// when the task became runnable, so start - enqueue is its queue wait.
+struct TraceEvent {
+    const char* name;   // Must outlive the recorder's dump (see intern()); nullptr prints "task"
+    uint64_t id;
+    uint64_t enqueue;
+    uint64_t start;
+    uint64_t end;
+};
+
+// A recorded event together with the recorder-assigned index of the thread
+// that ran it
+struct ThreadTraceEvent {
+    TraceEvent event;
+    uint32_t thread;
+};
+
+// Collects task spans from many threads without locking on the hot path.
+// Each thread appends to its own fixed-capacity buffer, found through a
+// one-entry thread_local cache, and publishes entries with a release store
+// of the buffer's size, so collect() may run while threads keep recording.
+// Events beyond a buffer's capacity are counted in dropped() and discarded.
+class TraceRecorder {
+public:
+    static constexpr size_t DEFAULT_EVENTS_PER_THREAD = 1 << 16;
+
+    explicit TraceRecorder(size_t events_per_thread = DEFAULT_EVENTS_PER_THREAD)
+        : capacity_(events_per_thread),
+          id_(next_recorder_id_.fetch_add(1, std::memory_order_relaxed)),
+          origin_ticks_(now()),
+          origin_ns_(steady_ns()) {}
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    ~TraceRecorder() {
+        ThreadBuffer* buffer = head_.load(std::memory_order_acquire);
+        while (buffer) {
+            ThreadBuffer* next = buffer->next;
+            delete buffer;
+            buffer = next;
+        }
+    }
+
+    // Raw timestamp for events: the invariant TSC on x86-64, which is several
+    // times cheaper than steady_clock, and steady_clock nanoseconds elsewhere.
+    // Exports convert ticks to nanoseconds against steady_clock.
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(_M_X64)
+        return __rdtsc();
+#else
+        return steady_ns();
+#endif
+    }
+
+    void record(const TraceEvent& event) {
+        ThreadBuffer* buffer = local_buffer();
+        size_t size = buffer->size.load(std::memory_order_relaxed);
+        if (size == capacity_) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer->events[size] = event;
+        buffer->size.store(size + 1, std::memory_order_release);
+    }
+
+    // Snapshot of everything published so far
+    std::vector<ThreadTraceEvent> collect() const {
+        std::vector<ThreadTraceEvent> events;
+        for (ThreadBuffer* buffer = head_.load(std::memory_order_acquire);
+             buffer; buffer = buffer->next) {
+            size_t size = buffer->size.load(std::memory_order_acquire);
+            for (size_t i = 0; i < size; ++i) {
+                events.push_back({buffer->events[i], buffer->index});
+            }
+        }
+        return events;
+    }
+
+    // Copies a label into storage owned by the recorder, for names that may
+    // not outlive the dump; equal names share one copy
+    const char* intern(std::string_view name) {
+        std::lock_guard lock(names_mutex_);
+        auto it = names_.find(name);
+        if (it == names_.end()) {
+            it = names_.emplace(name).first;
+        }
+        return it->c_str();
+    }
+
+    size_t dropped() const {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    // Chrome trace_event JSON, loadable in chrome://tracing and Perfetto.
+    // Each task becomes a complete ("X") event on its thread's track with
+    // the queue wait in args.
+    void write_chrome_trace(std::ostream& out) const {
+        auto events = collect();
+        uint64_t origin = UINT64_MAX;
+        for (const auto& e : events) {
+            origin = std::min(origin, std::min(e.event.enqueue, e.event.start));
+        }
+
+        uint64_t elapsed_ticks = now() - origin_ticks_;
+        uint64_t elapsed_ns = steady_ns() - origin_ns_;
+        double ns_per_tick = elapsed_ticks ? static_cast<double>(elapsed_ns) / elapsed_ticks : 1.0;
+        auto micros = [ns_per_tick](uint64_t ticks) {
+            auto ns = static_cast<uint64_t>(ticks * ns_per_tick);
+            return std::to_string(ns / 1000) + "." + pad3(ns % 1000);
+        };
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        for (ThreadBuffer* buffer = head_.load(std::memory_order_acquire);
+             buffer; buffer = buffer->next) {
+            out << (first ? "" : ",")
+                << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->index
+                << ",\"args\":{\"name\":\"worker " << buffer->index << "\"}}";
+            first = false;
+        }
+        for (const auto& e : events) {
+            const TraceEvent& event = e.event;
+            uint64_t wait = event.start > event.enqueue ? event.start - event.enqueue : 0;
+            out << (first ? "" : ",") << "{\"name\":\"";
+            write_escaped(out, event.name ? event.name : "task");
+            out << "\",\"cat\":\"task\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+                << ",\"ts\":" << micros(event.start - origin)
+                << ",\"dur\":" << micros(event.end - event.start)
+                << ",\"args\":{\"id\":" << event.id
+                << ",\"queue_wait_us\":" << micros(wait) << "}}";
+            first = false;
+        }
+        out << "]}\n";
+    }
+
+private:
+    struct ThreadBuffer {
+        ThreadBuffer(size_t capacity, uint32_t i, std::thread::id owner)
+            : events(std::make_unique<TraceEvent[]>(capacity)), index(i), thread(owner) {}
+
+        std::unique_ptr<TraceEvent[]> events;
+        std::atomic<size_t> size{0};
+        uint32_t index;
+        std::thread::id thread;
+        ThreadBuffer* next = nullptr;
+    };
+
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+
+    struct LocalCache {
+        uint64_t recorder;
+        ThreadBuffer* buffer;
+    };
+
+    ThreadBuffer* local_buffer() {
+        if (cache_.recorder == id_) {
+            return cache_.buffer;
+        }
+        ThreadBuffer* buffer = find_or_register();
+        cache_ = {id_, buffer};
+        return buffer;
+    }
+
+    // Slow path, taken once per thread and whenever a thread alternates
+    // between recorders
+    ThreadBuffer* find_or_register() {
+        auto self = std::this_thread::get_id();
+        for (ThreadBuffer* buffer = head_.load(std::memory_order_acquire);
+             buffer; buffer = buffer->next) {
+            if (buffer->thread == self) {
+                return buffer;
+            }
+        }
+        auto* buffer = new ThreadBuffer(capacity_,
+            thread_count_.fetch_add(1, std::memory_order_relaxed), self);
+        buffer->next = head_.load(std::memory_order_relaxed);
+        while (!head_.compare_exchange_weak(buffer->next, buffer,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+        }
+        return buffer;
+    }
+
+    static uint64_t steady_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static std::string pad3(uint64_t value) {
+        std::string digits = std::to_string(value);
+        return std::string(3 - digits.size(), '0') + digits;
+    }
+
+    static void write_escaped(std::ostream& out, const char* text) {
+        for (; *text; ++text) {
+            char c = *text;
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                out << ' ';
+            } else {
+                out << c;
+            }
+        }
+    }
+
+    const size_t capacity_;
+    // Unique across recorders, unlike addresses, so a stale cache entry can
+    // never match a new recorder allocated at the same address
+    const uint64_t id_;
+    const uint64_t origin_ticks_;
+    const uint64_t origin_ns_;
+    std::atomic<ThreadBuffer*> head_{nullptr};
+    std::atomic<uint32_t> thread_count_{0};
+    std::atomic<size_t> dropped_{0};
+    std::mutex names_mutex_;
+    std::unordered_set<std::string, NameHash, std::equal_to<>> names_;   // Node-based, so c_str() stays put
+
+    static inline std::atomic<uint64_t> next_recorder_id_{1};
+    static inline thread_local LocalCache cache_{0, nullptr};
+};
+
+} // namespace async_toolkit::logging
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace async_toolkit::network {
+
+// Growable byte FIFO over a power-of-two ring. Data is appended at the tail
+// and consumed from the head without moving the rest, and the readable or
+// writable space is exposed as at most two regions so it can be handed to
+// readv/writev directly. Not thread-safe.
+class RingBuffer {
+public:
+    using Regions = std::array<std::span<char>, 2>;
+
+    explicit RingBuffer(size_t initial_capacity = 4096)
+        : capacity_(round_up(std::max<size_t>(initial_capacity, 64))),
+          data_(std::make_unique<char[]>(capacity_)) {}
+
+    size_t size() const { return static_cast<size_t>(tail_ - head_); }
+    bool empty() const { return head_ == tail_; }
+    size_t capacity() const { return capacity_; }
+    size_t writable() const { return capacity_ - size(); }
+
+    // Grows, keeping the contents, until writable() >= bytes
+    void reserve(size_t bytes) {
+        if (writable() >= bytes) {
+            return;
+        }
+        size_t capacity = round_up(size() + bytes);
+        auto data = std::make_unique<char[]>(capacity);
+        size_t length = size();
+        copy_out(0, data.get(), length);
+        data_ = std::move(data);
+        capacity_ = capacity;
+        head_ = 0;
+        tail_ = length;
+    }
+
+    void append(const void* data, size_t length) {
+        reserve(length);
+        size_t offset = index(tail_);
+        size_t first = std::min(length, capacity_ - offset);
+        std::memcpy(data_.get() + offset, data, first);
+        std::memcpy(data_.get(), static_cast<const char*>(data) + first, length - first);
+        tail_ += length;
+    }
+
+    // length readable bytes starting offset bytes past the head
+    Regions readable_regions(size_t offset, size_t length) {
+        return regions(head_ + offset, length);
+    }
+
+    Regions readable_regions() {
+        return regions(head_, size());
+    }
+
+    // Free space after the tail; fill it, then commit() what was written
+    Regions writable_regions() {
+        return regions(tail_, writable());
+    }
+
+    void commit(size_t bytes) {
+        tail_ += std::min(bytes, writable());
+    }
+
+    void consume(size_t bytes) {
+        head_ += std::min(bytes, size());
+        if (head_ == tail_) {
+            // Restart at the front so the next fill is one contiguous region
+            head_ = tail_ = 0;
+        }
+    }
+
+    // Copies up to length bytes out and consumes them
+    size_t read(void* out, size_t length) {
+        length = std::min(length, size());
+        copy_out(0, static_cast<char*>(out), length);
+        consume(length);
+        return length;
+    }
+
+    std::string retrieve(size_t length) {
+        std::string result(std::min(length, size()), '\0');
+        read(result.data(), result.size());
+        return result;
+    }
+
+    std::string retrieve_all() {
+        return retrieve(size());
+    }
+
+    void clear() {
+        head_ = tail_ = 0;
+    }
+
+private:
+    static size_t round_up(size_t value) {
+        size_t capacity = 64;
+        while (capacity < value) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    size_t index(uint64_t position) const {
+        return static_cast<size_t>(position & (capacity_ - 1));
+    }
+
+    Regions regions(uint64_t position, size_t length) {
+        size_t offset = index(position);
+        size_t first = std::min(length, capacity_ - offset);
+        return {std::span<char>(data_.get() + offset, first),
+                std::span<char>(data_.get(), length - first)};
+    }
+
+    void copy_out(size_t offset, char* out, size_t length) const {
+        size_t start = index(head_ + offset);
+        size_t first = std::min(length, capacity_ - start);
+        std::memcpy(out, data_.get() + start, first);
+        std::memcpy(out + first, data_.get(), length - first);
+    }
+
+    size_t capacity_;
+    std::unique_ptr<char[]> data_;
+    uint64_t head_ = 0;
+    uint64_t tail_ = 0;
+};
+
+} // namespace async_toolkit::network
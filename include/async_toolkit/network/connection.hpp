@@ -0,0 +1,808 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "buffer.hpp"
+#include "../reactor/event_loop.hpp"
+
+#ifndef _WIN32
+#include <csignal>
+#include <ctime>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+// MSG_ZEROCOPY (Linux 4.14) needs the completion notifications from the
+// socket error queue described in <linux/errqueue.h>
+#if defined(__linux__) && defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY) && \
+    __has_include(<linux/errqueue.h>)
+#define ASYNC_TOOLKIT_HAS_MSG_ZEROCOPY 1
+#include <linux/errqueue.h>
+#endif
+
+namespace async_toolkit::network {
+
+#ifndef _WIN32
+// A write to a peer that reset the connection raises SIGPIPE, which kills
+// the process by default. Sends pass MSG_NOSIGNAL; platforms without it
+// set SO_NOSIGPIPE on the socket instead.
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// sendfile takes no flags and Linux has no SO_NOSIGPIPE, so SIGPIPE is
+// blocked on this thread for the call. One the call raised is consumed
+// before the mask is restored; one already pending is left alone.
+class SigpipeGuard {
+public:
+    SigpipeGuard() {
+        sigemptyset(&sigpipe_);
+        sigaddset(&sigpipe_, SIGPIPE);
+        sigset_t pending;
+        sigpending(&pending);
+        was_pending_ = sigismember(&pending, SIGPIPE) == 1;
+        pthread_sigmask(SIG_BLOCK, &sigpipe_, &previous_);
+    }
+
+    ~SigpipeGuard() {
+        int saved_errno = errno;
+        if (!was_pending_) {
+            timespec zero{};
+            while (sigtimedwait(&sigpipe_, nullptr, &zero) < 0 && errno == EINTR) {
+            }
+        }
+        pthread_sigmask(SIG_SETMASK, &previous_, nullptr);
+        errno = saved_errno;
+    }
+
+    SigpipeGuard(const SigpipeGuard&) = delete;
+    SigpipeGuard& operator=(const SigpipeGuard&) = delete;
+
+private:
+    sigset_t sigpipe_;
+    sigset_t previous_;
+    bool was_pending_;
+};
+#endif
+
+// Buffered non-blocking TCP connection driven by an EventLoop. Incoming
+// bytes are read into input() with readv and announced through the read
+// callback. Outgoing bytes queue in order: small writes are copied into a
+// ring buffer, large strings are moved in as their own chunks, and the
+// whole queue goes out in one gathering sendmsg per loop iteration however
+// many send() calls produced it. File ranges join the same queue and go out with
+// sendfile, so they stay in order with the bytes around them.
+//
+// Callbacks, start() and destruction belong to the loop thread; send() from
+// another thread hops over with queue_in_loop. Create connections with
+// std::make_shared: the hop, the deferred flush and in-callback teardown
+// need it.
+class Connection : public std::enable_shared_from_this<Connection> {
+public:
+    using Ptr = std::shared_ptr<Connection>;
+    using EventCallback = std::function<void()>;
+    using HighWaterMarkCallback = std::function<void(size_t queued)>;
+
+    // Strings at least this long are queued by move instead of copied
+    static constexpr size_t OWNED_CHUNK_THRESHOLD = 16 * 1024;
+    static constexpr size_t DEFAULT_HIGH_WATER_MARK = 64 * 1024 * 1024;
+
+    Connection(reactor::FileDescriptor fd, reactor::EventLoop& loop)
+        : fd_(fd), loop_(loop), connected_(true) {
+#ifdef _WIN32
+        u_long non_blocking = 1;
+        ioctlsocket(fd_, FIONBIO, &non_blocking);
+#else
+        int flags = fcntl(fd_, F_GETFL, 0);
+        if (flags >= 0 && !(flags & O_NONBLOCK)) {
+            fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
+        }
+#ifdef SO_NOSIGPIPE
+        set_option(SOL_SOCKET, SO_NOSIGPIPE, 1);
+#endif
+#endif
+    }
+
+    ~Connection() {
+        disconnect();
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // Safe to call from any thread
+    bool is_connected() const { return connected_.load(std::memory_order_acquire); }
+
+    // errno of the read or write that failed and closed the connection, or
+    // 0; read it on the loop thread, e.g. in the close callback
+    int error() const { return error_; }
+
+    // Closes immediately, dropping unsent output
+    void disconnect() {
+        if (connected_) {
+            connected_ = false;
+            if (started_) {
+                loop_.unregister_handler(fd_);
+            }
+            release_output();
+#ifdef _WIN32
+            closesocket(fd_);
+#else
+            close(fd_);
+#endif
+        }
+    }
+
+    // Registers with the loop; call on the loop thread once callbacks are set
+    void start() {
+        if (started_ || !connected_) {
+            return;
+        }
+        started_ = true;
+        loop_.register_handler(fd_, [this](uint32_t events) { handle_events(events); },
+                               reactor::EVENT_READ);
+        if (!chunks_.empty()) {
+            schedule_flush();
+        }
+    }
+
+    // Called after new bytes land in input()
+    void set_read_callback(EventCallback cb) {
+        read_callback_ = std::move(cb);
+    }
+
+    // Called whenever the output queue drains completely, including any
+    // zero-copy buffers the kernel still held
+    void set_write_callback(EventCallback cb) {
+        write_callback_ = std::move(cb);
+    }
+
+    // Called once when the socket fails, or when the peer has closed and
+    // the queued output has been sent, before the connection closes itself
+    void set_close_callback(EventCallback cb) {
+        close_callback_ = std::move(cb);
+    }
+
+    // Called when queued output grows past mark bytes, so producers can
+    // pause until the write callback reports the queue drained
+    void set_high_water_mark_callback(HighWaterMarkCallback cb, size_t mark) {
+        high_water_mark_callback_ = std::move(cb);
+        high_water_mark_ = mark;
+    }
+
+    void send(const void* data, size_t length) {
+        if (length == 0) {
+            return;
+        }
+        if (needs_hop()) {
+            send(std::string(static_cast<const char*>(data), length));
+            return;
+        }
+        if (!connected_) {
+            return;
+        }
+        size_t before = queued_bytes_;
+        output_.append(data, length);
+        if (!chunks_.empty() && chunks_.back().kind == ChunkKind::BUFFERED) {
+            chunks_.back().length += length;
+        } else {
+            chunks_.push_back({ChunkKind::BUFFERED, {}, 0, length});
+        }
+        queued(before, length);
+    }
+
+    void send(std::string_view data) {
+        send(data.data(), data.size());
+    }
+
+    // Picks the copying overload for literals, which would otherwise be
+    // ambiguous between string_view and string&&
+    void send(const char* data) {
+        send(std::string_view(data));
+    }
+
+    void send(std::string&& data) {
+        if (data.empty()) {
+            return;
+        }
+        if (needs_hop()) {
+            std::weak_ptr<Connection> weak = weak_from_this();
+            loop_.queue_in_loop([weak, data = std::move(data)]() mutable {
+                if (auto self = weak.lock()) {
+                    self->send(std::move(data));
+                }
+            });
+            return;
+        }
+        if (data.size() < OWNED_CHUNK_THRESHOLD) {
+            send(data.data(), data.size());
+            return;
+        }
+        if (!connected_) {
+            return;
+        }
+        size_t before = queued_bytes_;
+        size_t length = data.size();
+        chunks_.push_back({ChunkKind::OWNED, std::move(data), 0, length});
+        queued(before, length);
+    }
+
+#ifndef _WIN32
+    // Queues length bytes of the regular file file_fd starting at offset.
+    // They are sent with sendfile, straight from the page cache, after
+    // everything queued before them. The fd is duplicated, so the caller
+    // may close its own copy right away. Pipes and sockets are not accepted
+    // as sources; there is no splice path.
+    void send_file(int file_fd, off_t offset, size_t length) {
+        if (length == 0) {
+            return;
+        }
+        struct stat info;
+        if (fstat(file_fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            throw std::invalid_argument("send_file needs a regular file");
+        }
+        if (offset < 0 || static_cast<uint64_t>(offset) + length > static_cast<uint64_t>(info.st_size)) {
+            throw std::invalid_argument("send_file range is past the end of the file");
+        }
+        int file = fcntl(file_fd, F_DUPFD_CLOEXEC, 0);
+        if (file < 0) {
+            throw std::runtime_error(std::string("send_file could not duplicate fd: ") + std::strerror(errno));
+        }
+        if (needs_hop()) {
+            std::weak_ptr<Connection> weak = weak_from_this();
+            loop_.queue_in_loop([weak, file, offset, length] {
+                if (auto self = weak.lock()) {
+                    self->queue_file(file, offset, length);
+                } else {
+                    close(file);
+                }
+            });
+            return;
+        }
+        queue_file(file, offset, length);
+    }
+#endif
+
+    // Sends strings queued by move with MSG_ZEROCOPY: the kernel reads them
+    // in place and reports on the error queue when it is done with them.
+    // Worth it for large payloads only; returns false where unsupported.
+    // Turns itself off if the kernel reports that it had to copy anyway,
+    // as it does over loopback.
+    bool set_zero_copy(bool enable) {
+#ifdef ASYNC_TOOLKIT_HAS_MSG_ZEROCOPY
+        if (enable && !set_option(SOL_SOCKET, SO_ZEROCOPY, 1)) {
+            return false;
+        }
+        zero_copy_ = enable;
+        return true;
+#else
+        return !enable;
+#endif
+    }
+
+    bool zero_copy() const { return zero_copy_; }
+
+    RingBuffer& input() { return input_; }
+
+    // Bytes accepted by send() and not yet written to the socket
+    size_t queued_bytes() const { return queued_bytes_; }
+
+    bool set_tcp_no_delay(bool enable) {
+        return set_option(IPPROTO_TCP, TCP_NODELAY, enable ? 1 : 0);
+    }
+
+    bool set_keep_alive(bool enable) {
+        return set_option(SOL_SOCKET, SO_KEEPALIVE, enable ? 1 : 0);
+    }
+
+    // Kernel socket buffer sizes; Linux doubles the value for bookkeeping
+    bool set_send_buffer_size(int bytes) {
+        return set_option(SOL_SOCKET, SO_SNDBUF, bytes);
+    }
+
+    bool set_receive_buffer_size(int bytes) {
+        return set_option(SOL_SOCKET, SO_RCVBUF, bytes);
+    }
+
+    reactor::FileDescriptor fd() const { return fd_; }
+
+private:
+    enum class ChunkKind {
+        BUFFERED,   // length bytes of output_, in queue order
+        OWNED,      // data[offset, offset + length)
+        FILE_RANGE  // file[offset, offset + length), file owned by the chunk
+    };
+
+    struct Chunk {
+        ChunkKind kind;
+        std::string data;
+        size_t offset;
+        size_t length;
+        int file = -1;
+        bool zero_copy = false;     // Part of data went out with MSG_ZEROCOPY
+        uint32_t zero_copy_id = 0;  // Notification id of the latest such send
+    };
+
+    // A fully sent string the kernel may still be reading
+    struct ZeroCopyBuffer {
+        uint32_t id;
+        std::string data;
+    };
+
+    static constexpr int MAX_IOVECS = 64;
+    static constexpr size_t EXTRA_READ_BUFFER = 64 * 1024;
+
+    // Calls from other threads, or made before the loop runs, are replayed
+    // on the loop thread; that needs shared ownership
+    bool needs_hop() {
+        return !loop_.is_in_loop_thread() && !weak_from_this().expired();
+    }
+
+    bool set_option(int level, int name, int value) {
+        return setsockopt(fd_, level, name, reinterpret_cast<const char*>(&value), sizeof(value)) == 0;
+    }
+
+#ifndef _WIN32
+    void queue_file(int file, off_t offset, size_t length) {
+        if (!connected_) {
+            close(file);
+            return;
+        }
+        size_t before = queued_bytes_;
+        chunks_.push_back({ChunkKind::FILE_RANGE, {}, static_cast<size_t>(offset), length, file});
+        queued(before, length);
+    }
+#endif
+
+    void queued(size_t before, size_t length) {
+        queued_bytes_ += length;
+        if (high_water_mark_callback_ && before < high_water_mark_ && queued_bytes_ >= high_water_mark_) {
+            high_water_mark_callback_(queued_bytes_);
+        }
+        schedule_flush();
+    }
+
+    // Defers the write to the end of the loop iteration so every send()
+    // made meanwhile shares one sendmsg. While waiting for EVENT_WRITE the
+    // writable notification does the flushing instead.
+    void schedule_flush() {
+        if (flush_scheduled_ || waiting_writable_ || !started_) {
+            return;
+        }
+        std::weak_ptr<Connection> weak = weak_from_this();
+        if (weak.expired()) {
+            flush();
+            return;
+        }
+        flush_scheduled_ = true;
+        loop_.queue_in_loop([weak] {
+            if (auto self = weak.lock()) {
+                self->flush_scheduled_ = false;
+                self->flush();
+            }
+        });
+    }
+
+    void handle_events(uint32_t events) {
+        // Keeps the connection alive if a callback drops the last owner
+        auto self = weak_from_this().lock();
+        // A hangup may only be the peer's half-close; reading tells
+        if (!peer_closed_ && (events & (reactor::EVENT_READ | reactor::EVENT_HANGUP))) {
+            handle_read();
+        }
+        if (connected_ && waiting_writable_ && (events & reactor::EVENT_WRITE)) {
+            flush();
+        }
+        if (connected_ && (events & reactor::EVENT_ERROR)) {
+#ifdef ASYNC_TOOLKIT_HAS_MSG_ZEROCOPY
+            // Zero-copy completions also raise EPOLLERR; only a pending
+            // socket error means the connection failed
+            if (zero_copy_used_) {
+                read_error_queue();
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &length);
+                if (error == 0) {
+                    return;
+                }
+            }
+#endif
+            handle_close();
+        }
+    }
+
+    // Edge-triggered: read until the socket is drained. Each readv fills
+    // the ring's free space plus a stack buffer, so one call takes a large
+    // burst without growing the ring up front.
+    void handle_read() {
+        bool received = false;
+        bool eof = false;
+        bool failed = false;
+        while (true) {
+            input_.reserve(4096);
+            auto regions = input_.writable_regions();
+            char extra[EXTRA_READ_BUFFER];
+            size_t writable = regions[0].size() + regions[1].size();
+#ifdef _WIN32
+            int n = recv(fd_, regions[0].data(), static_cast<int>(regions[0].size()), 0);
+            size_t capacity = regions[0].size();
+            if (n < 0 && WSAGetLastError() == WSAEWOULDBLOCK) {
+                break;
+            }
+            (void)extra;
+            (void)writable;
+#else
+            iovec iov[3];
+            int count = 0;
+            for (auto& region : regions) {
+                if (!region.empty()) {
+                    iov[count++] = {region.data(), region.size()};
+                }
+            }
+            iov[count++] = {extra, sizeof(extra)};
+            ssize_t n = readv(fd_, iov, count);
+            size_t capacity = writable + sizeof(extra);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+#endif
+            if (n <= 0) {
+                (n == 0 ? eof : failed) = true;
+#ifdef _WIN32
+                error_ = n < 0 ? WSAGetLastError() : 0;
+#else
+                error_ = n < 0 ? errno : 0;
+#endif
+                break;
+            }
+            auto bytes = static_cast<size_t>(n);
+#ifdef _WIN32
+            input_.commit(bytes);
+#else
+            if (bytes <= writable) {
+                input_.commit(bytes);
+            } else {
+                input_.commit(writable);
+                input_.append(extra, bytes - writable);
+            }
+#endif
+            received = true;
+            if (bytes < capacity) {
+                break;
+            }
+        }
+        if (received && read_callback_) {
+            read_callback_();
+        }
+        if (!connected_) {
+            return;
+        }
+        if (failed) {
+            handle_close();
+        } else if (eof) {
+            // Half-close: finish sending what is queued, then close
+            peer_closed_ = true;
+            if (chunks_.empty() && zero_copy_buffers_.empty()) {
+                handle_close();
+            }
+        }
+    }
+
+    void flush() {
+        if (!connected_) {
+            return;
+        }
+        while (!chunks_.empty()) {
+            size_t requested = 0;
+            long written = write_chunks(requested);
+            if (written < 0) {
+#ifdef _WIN32
+                bool would_block = WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+                if (errno == EINTR) {
+                    continue;
+                }
+                bool would_block = errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+                if (would_block) {
+                    break;
+                }
+#ifdef _WIN32
+                error_ = WSAGetLastError();
+#else
+                error_ = errno;
+#endif
+                handle_close();
+                return;
+            }
+            consume_output(static_cast<size_t>(written));
+            if (static_cast<size_t>(written) < requested) {
+                break;   // Socket buffer full
+            }
+        }
+
+        if (!chunks_.empty()) {
+            if (!waiting_writable_) {
+                waiting_writable_ = true;
+                loop_.modify_handler(fd_, reactor::EVENT_READ | reactor::EVENT_WRITE);
+            }
+            return;
+        }
+        if (waiting_writable_) {
+            waiting_writable_ = false;
+            loop_.modify_handler(fd_, reactor::EVENT_READ);
+        }
+        if (zero_copy_buffers_.empty()) {
+            drained();
+        }
+    }
+
+    void drained() {
+        if (write_callback_) {
+            write_callback_();
+        }
+        if (peer_closed_ && connected_) {
+            handle_close();
+        }
+    }
+
+    // Gathers up to MAX_IOVECS regions from the front of the queue into one
+    // sendmsg, stopping at a file chunk, which goes out on its own with
+    // sendfile. Returns the result and the byte count asked for.
+    long write_chunks(size_t& requested) {
+#ifndef _WIN32
+        if (chunks_.front().kind == ChunkKind::FILE_RANGE) {
+            return write_file(chunks_.front(), requested);
+        }
+#endif
+#ifdef ASYNC_TOOLKIT_HAS_MSG_ZEROCOPY
+        if (zero_copy_ && chunks_.front().kind == ChunkKind::OWNED) {
+            return write_zero_copy(requested);
+        }
+#endif
+#ifdef _WIN32
+        const Chunk& chunk = chunks_.front();
+        const char* data;
+        if (chunk.kind == ChunkKind::BUFFERED) {
+            data = output_.readable_regions(0, chunk.length)[0].data();
+            requested = output_.readable_regions(0, chunk.length)[0].size();
+        } else {
+            data = chunk.data.data() + chunk.offset;
+            requested = chunk.length;
+        }
+        return ::send(fd_, data, static_cast<int>(requested), 0);
+#else
+        iovec iov[MAX_IOVECS];
+        int count = 0;
+        size_t ring_offset = 0;
+        for (const Chunk& chunk : chunks_) {
+            if (count == MAX_IOVECS || chunk.kind == ChunkKind::FILE_RANGE) {
+                break;
+            }
+            if (chunk.kind == ChunkKind::BUFFERED) {
+                for (auto& region : output_.readable_regions(ring_offset, chunk.length)) {
+                    if (!region.empty() && count < MAX_IOVECS) {
+                        iov[count++] = {region.data(), region.size()};
+                        requested += region.size();
+                    }
+                }
+                ring_offset += chunk.length;
+            } else {
+                iov[count++] = {const_cast<char*>(chunk.data.data()) + chunk.offset, chunk.length};
+                requested += chunk.length;
+            }
+        }
+        msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = static_cast<decltype(message.msg_iovlen)>(count);
+        return sendmsg(fd_, &message, SEND_FLAGS);
+#endif
+    }
+
+#ifndef _WIN32
+    long write_file(const Chunk& chunk, size_t& requested) {
+        auto offset = static_cast<off_t>(chunk.offset);
+#ifdef __linux__
+        requested = chunk.length;
+        ssize_t n;
+        {
+            SigpipeGuard guard;
+            n = sendfile(fd_, chunk.file, &offset, chunk.length);
+        }
+#else
+        // No portable sendfile elsewhere: copy through a stack buffer
+        char buffer[EXTRA_READ_BUFFER];
+        ssize_t n = pread(chunk.file, buffer, std::min(chunk.length, sizeof(buffer)), offset);
+        if (n > 0) {
+            requested = static_cast<size_t>(n);
+            n = ::send(fd_, buffer, requested, SEND_FLAGS);
+        }
+#endif
+        if (n == 0) {
+            // The file shrank after send_file checked its size
+            errno = EIO;
+            return -1;
+        }
+        return n;
+    }
+#endif
+
+#ifdef ASYNC_TOOLKIT_HAS_MSG_ZEROCOPY
+    // Sends the owned strings at the front of the queue with MSG_ZEROCOPY.
+    // Ring buffer bytes never go this way: their memory is reused as soon
+    // as it is consumed, while the kernel may still be reading it.
+    long write_zero_copy(size_t& requested) {
+        iovec iov[MAX_IOVECS];
+        int count = 0;
+        for (const Chunk& chunk : chunks_) {
+            if (count == MAX_IOVECS || chunk.kind != ChunkKind::OWNED) {
+                break;
+            }
+            iov[count++] = {const_cast<char*>(chunk.data.data()) + chunk.offset, chunk.length};
+            requested += chunk.length;
+        }
+        msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = static_cast<size_t>(count);
+        ssize_t n = sendmsg(fd_, &message, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        if (n > 0) {
+            // The kernel numbers every zero-copy send that took data;
+            // tag the strings it now references with that number
+            zero_copy_used_ = true;
+            uint32_t id = next_zero_copy_id_++;
+            size_t remaining = static_cast<size_t>(n);
+            for (Chunk& chunk : chunks_) {
+                if (remaining == 0) {
+                    break;
+                }
+                chunk.zero_copy = true;
+                chunk.zero_copy_id = id;
+                remaining -= std::min(remaining, chunk.length);
+            }
+        }
+        return n;
+    }
+
+    // Drains zero-copy completions. Each covers an inclusive id range, and
+    // TCP completes sends in order, so everything up to its end is free.
+    void read_error_queue() {
+        bool released = false;
+        while (true) {
+            char control[128];
+            msghdr message{};
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            if (recvmsg(fd_, &message, MSG_ERRQUEUE) < 0) {
+                break;
+            }
+            for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+                bool recv_error = (header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR) ||
+                                  (header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR);
+                if (!recv_error) {
+                    continue;
+                }
+                sock_extended_err error;
+                std::memcpy(&error, CMSG_DATA(header), sizeof(error));
+                if (error.ee_origin != SO_EE_ORIGIN_ZEROCOPY || error.ee_errno != 0) {
+                    continue;
+                }
+                while (!zero_copy_buffers_.empty() &&
+                       static_cast<int32_t>(zero_copy_buffers_.front().id - error.ee_data) <= 0) {
+                    zero_copy_buffers_.pop_front();
+                    released = true;
+                }
+                if (error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                    zero_copy_ = false;
+                }
+            }
+        }
+        if (released && zero_copy_buffers_.empty() && chunks_.empty()) {
+            drained();
+        }
+    }
+#endif
+
+    void consume_output(size_t written) {
+        queued_bytes_ -= written;
+        while (written > 0) {
+            Chunk& chunk = chunks_.front();
+            size_t taken = std::min(written, chunk.length);
+            if (chunk.kind == ChunkKind::BUFFERED) {
+                output_.consume(taken);
+            } else {
+                chunk.offset += taken;
+            }
+            chunk.length -= taken;
+            written -= taken;
+            if (chunk.length == 0) {
+                release_chunk(chunk);
+                chunks_.pop_front();
+            }
+        }
+    }
+
+    // Closes a finished file, or parks a string the kernel may still read
+    void release_chunk(Chunk& chunk) {
+#ifndef _WIN32
+        if (chunk.kind == ChunkKind::FILE_RANGE) {
+            close(chunk.file);
+        }
+#endif
+        if (chunk.zero_copy) {
+            zero_copy_buffers_.push_back({chunk.zero_copy_id, std::move(chunk.data)});
+        }
+    }
+
+    void release_output() {
+#ifndef _WIN32
+        for (Chunk& chunk : chunks_) {
+            if (chunk.kind == ChunkKind::FILE_RANGE) {
+                close(chunk.file);
+            }
+        }
+#endif
+#ifdef ASYNC_TOOLKIT_HAS_MSG_ZEROCOPY
+        if (zero_copy_used_ && !zero_copy_buffers_.empty()) {
+            // Reset rather than close gracefully, so the kernel drops the
+            // unsent data still pointing into the buffers freed below
+            linger reset{1, 0};
+            setsockopt(fd_, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+        }
+#endif
+        chunks_.clear();
+        zero_copy_buffers_.clear();
+        output_.clear();
+        queued_bytes_ = 0;
+    }
+
+    void handle_close() {
+        auto self = weak_from_this().lock();
+        if (close_callback_) {
+            close_callback_();
+        }
+        disconnect();
+    }
+
+    reactor::FileDescriptor fd_;
+    reactor::EventLoop& loop_;
+    std::atomic<bool> connected_;
+    bool started_ = false;
+    bool flush_scheduled_ = false;
+    bool waiting_writable_ = false;
+    bool peer_closed_ = false;
+    bool zero_copy_ = false;
+    bool zero_copy_used_ = false;
+    int error_ = 0;
+    EventCallback read_callback_;
+    EventCallback write_callback_;
+    EventCallback close_callback_;
+    HighWaterMarkCallback high_water_mark_callback_;
+    size_t high_water_mark_ = DEFAULT_HIGH_WATER_MARK;
+    RingBuffer input_;
+    RingBuffer output_;
+    std::deque<Chunk> chunks_;
+    std::deque<ZeroCopyBuffer> zero_copy_buffers_;
+    uint32_t next_zero_copy_id_ = 0;
+    size_t queued_bytes_ = 0;
+};
+
+} // namespace async_toolkit::network
@@ -1,95 +1,698 @@
 #pragma once
 
-#include <memory>
-#include <vector>
-#include <queue>
-#include <mutex>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
+#include <coroutine>
+#include <deque>
 #include <functional>
-#include "../reactor/event_loop.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "connection.hpp"
+#include "../reactor/socket_address.hpp"
+
+#ifndef _WIN32
 
 namespace async_toolkit::network {
 
-class Connection {
+// Limits of a ConnectionPool, applied to every endpoint separately
+struct ConnectionPoolOptions {
+    size_t max_size = 100;      // Leased, idle and dialing connections together
+    size_t min_idle = 0;        // Idle connections dialed ahead of demand
+    // Idle connections beyond min_idle close after this long unused
+    std::chrono::milliseconds idle_timeout{60000};
+    std::chrono::milliseconds connect_timeout{3000};
+    // How long acquire() waits for a connection; zero waits indefinitely
+    std::chrono::milliseconds acquire_timeout{5000};
+    std::chrono::milliseconds maintenance_interval{1000};
+};
+
+struct ConnectionPoolStats {
+    size_t endpoints = 0;
+    size_t idle = 0;
+    size_t leased = 0;
+    size_t dialing = 0;
+    size_t waiters = 0;
+    size_t created = 0;
+    size_t dial_failures = 0;
+    size_t evicted = 0;     // Closed while idle: expired, broken or failing validation
+    size_t timeouts = 0;    // acquire() calls that gave up waiting
+    size_t cached = 0;      // Held in per-thread caches, counted as leased too
+};
+
+// Client connections to many endpoints, with a sub-pool per endpoint.
+// Connections are dialed asynchronously on demand up to max_size and
+// reused most-recently-released first, so the warmest ones stay in use and
+// the rest age out. When an endpoint is at max_size, acquire() queues
+// until a connection comes back or the acquire timeout expires.
+//
+// A periodic maintenance pass drops idle connections that broke or expired
+// and dials new ones up to min_idle. An idle connection is handed out only
+// if it is still connected, has no unread input (stray bytes mean the
+// protocol lost sync) and passes the optional validator.
+//
+// Everything runs on the loop thread; acquire() and release() may be called
+// from any thread. Callbacks run on the loop thread. Every acquired
+// connection must come back through release(), broken or not, and the
+// pool must outlive its leases.
+//
+// Threads that acquire and release at a high rate can skip the loop with
+// release_local() and try_acquire_local(): each thread keeps its last few
+// connections in a cache of its own, reused newest first, and only a full
+// cache or a miss goes to the shared pool. Connections left unused in a
+// thread cache for a maintenance interval move back to the shared pool.
+class ConnectionPool {
 public:
-    using Ptr = std::shared_ptr<Connection>;
-    using EventCallback = std::function<void()>;
+    // Receives nullptr when connecting failed or the wait timed out
+    using AcquireCallback = std::function<void(Connection::Ptr)>;
+    using Validator = std::function<bool(Connection&)>;
+
+    class AcquireOperation;
 
-    Connection(reactor::FileDescriptor fd, reactor::EventLoop& loop)
-        : fd_(fd), loop_(loop), connected_(true) {}
+    explicit ConnectionPool(reactor::EventLoop& loop, const ConnectionPoolOptions& options = {})
+        : loop_(loop), options_(options) {
+        options_.max_size = std::max<size_t>(options_.max_size, 1);
+        options_.min_idle = std::min(options_.min_idle, options_.max_size);
+        maintenance_timer_ = loop_.run_every(options_.maintenance_interval, [this] { maintain(); });
+    }
 
-    ~Connection() {
-        disconnect();
+    // On the loop thread. Pending acquire() callbacks and async_acquire()
+    // awaiters receive nullptr and must not use the pool again.
+    ~ConnectionPool() {
+        loop_.cancel_timer(maintenance_timer_);
+        for (auto& [key, host] : hosts_) {
+            while (!host->waiters.empty()) {
+                fail_waiter(*host);
+            }
+        }
+        for (auto& [fd, dial] : dials_) {
+            loop_.cancel_timer(dial.timer);
+            loop_.unregister_handler(fd);
+            close(fd);
+        }
+        for (auto& entry : local_caches_) {
+            delete entry.load(std::memory_order_acquire);
+        }
     }
 
-    bool is_connected() const { return connected_; }
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
 
-    void disconnect() {
-        if (connected_) {
-            connected_ = false;
-#ifdef _WIN32
-            closesocket(fd_);
-#else
-            close(fd_);
-#endif
+    // Extra check on idle connections before reuse and during maintenance;
+    // set it before the first acquire()
+    void set_validator(Validator validator) {
+        validator_ = std::move(validator);
+    }
+
+    void acquire(const reactor::SocketAddress& endpoint, AcquireCallback callback) {
+        acquire(endpoint, std::move(callback), options_.acquire_timeout);
+    }
+
+    void acquire(const reactor::SocketAddress& endpoint, AcquireCallback callback,
+                 std::chrono::milliseconds timeout) {
+        loop_.run_in_loop([this, endpoint, callback = std::move(callback), timeout]() mutable {
+            acquire_in_loop(host_for(endpoint), std::move(callback), timeout);
+        });
+    }
+
+    // co_await pool.async_acquire(endpoint); nullptr on failure
+    AcquireOperation async_acquire(const reactor::SocketAddress& endpoint);
+
+    // Returns a leased connection. Its callbacks are cleared; a broken one
+    // is dropped and its slot redialed if someone is waiting.
+    void release(Connection::Ptr connection) {
+        if (!connection) {
+            return;
+        }
+        loop_.run_in_loop([this, connection = std::move(connection)]() mutable {
+            release_in_loop(std::move(connection));
+        });
+    }
+
+    // Connection most recently given to release_local() by this thread for
+    // endpoint, or nullptr; fall back to acquire() then. Touches only the
+    // calling thread's cache. Only is_connected() is checked: the validator
+    // and the input check need the loop thread.
+    Connection::Ptr try_acquire_local(const reactor::SocketAddress& endpoint) {
+        LocalCache* cache = local_cache(false);
+        if (!cache) {
+            return nullptr;
+        }
+        while (true) {
+            LocalCache::Slot* newest = nullptr;
+            for (auto& slot : cache->slots) {
+                if (slot.state.load(std::memory_order_acquire) == LocalCache::FULL &&
+                    slot.endpoint == endpoint && (!newest || slot.stamp > newest->stamp)) {
+                    newest = &slot;
+                }
+            }
+            if (!newest) {
+                return nullptr;
+            }
+            Connection::Ptr connection = cache->take(*newest);
+            if (!connection) {
+                continue;   // Maintenance got there first
+            }
+            if (connection->is_connected()) {
+                return connection;
+            }
+            release(std::move(connection));
         }
     }
 
-    void set_read_callback(EventCallback cb) {
-        read_callback_ = std::move(cb);
+    // Keeps connection, leased for endpoint, in this thread's cache. When
+    // the cache is full its oldest entry goes back to the shared pool; a
+    // thread without a cache releases to the shared pool directly.
+    void release_local(const reactor::SocketAddress& endpoint, Connection::Ptr connection) {
+        if (!connection) {
+            return;
+        }
+        LocalCache* cache = local_cache(true);
+        if (!cache || !connection->is_connected()) {
+            release(std::move(connection));
+            return;
+        }
+        LocalCache::Slot* target = nullptr;
+        for (auto& slot : cache->slots) {
+            if (slot.state.load(std::memory_order_relaxed) == LocalCache::EMPTY) {
+                target = &slot;
+                break;
+            }
+            if (!target || slot.stamp < target->stamp) {
+                target = &slot;
+            }
+        }
+        uint32_t expected = target->state.load(std::memory_order_relaxed);
+        if (expected == LocalCache::BUSY ||
+            !target->state.compare_exchange_strong(expected, LocalCache::BUSY, std::memory_order_acquire)) {
+            release(std::move(connection));
+            return;
+        }
+        Connection::Ptr evicted = std::move(target->connection);
+        target->endpoint = endpoint;
+        target->connection = std::move(connection);
+        target->stamp = ++cache->next_stamp;
+        target->since = std::chrono::steady_clock::now();
+        target->state.store(LocalCache::FULL, std::memory_order_release);
+        if (evicted) {
+            release(std::move(evicted));
+        }
     }
 
-    void set_write_callback(EventCallback cb) {
-        write_callback_ = std::move(cb);
+    // Creates the endpoint's sub-pool and dials it up to min_idle now
+    // instead of on first use
+    void warm_up(const reactor::SocketAddress& endpoint) {
+        loop_.run_in_loop([this, endpoint] { fill(host_for(endpoint)); });
     }
 
-    reactor::FileDescriptor fd() const { return fd_; }
+    // Safe to call from any thread
+    ConnectionPoolStats stats() const {
+        return ConnectionPoolStats{
+            .endpoints = endpoints_.load(std::memory_order_relaxed),
+            .idle = idle_.load(std::memory_order_relaxed),
+            .leased = leased_.load(std::memory_order_relaxed),
+            .dialing = dialing_.load(std::memory_order_relaxed),
+            .waiters = waiting_.load(std::memory_order_relaxed),
+            .created = created_.load(std::memory_order_relaxed),
+            .dial_failures = dial_failures_.load(std::memory_order_relaxed),
+            .evicted = evicted_.load(std::memory_order_relaxed),
+            .timeouts = timeouts_.load(std::memory_order_relaxed),
+            .cached = count_cached()};
+    }
 
 private:
-    reactor::FileDescriptor fd_;
-    reactor::EventLoop& loop_;
-    bool connected_;
-    EventCallback read_callback_;
-    EventCallback write_callback_;
-};
+    struct IdleConnection {
+        Connection::Ptr connection;
+        std::chrono::steady_clock::time_point since;
+    };
 
-class ConnectionPool {
-public:
-    explicit ConnectionPool(size_t max_size = 100)
-        : max_size_(max_size) {}
+    struct Waiter {
+        uint64_t id;
+        AcquireCallback callback;
+        reactor::TimerId timer;
+    };
+
+    // Sub-pool of one endpoint
+    struct Host {
+        reactor::SocketAddress address;
+        std::vector<IdleConnection> idle;   // Most recently released last
+        std::deque<Waiter> waiters;
+        size_t open = 0;                    // Leased, idle and dialing
+        size_t dialing = 0;
+        // After a failed dial, fill() leaves the endpoint alone until then
+        std::chrono::steady_clock::time_point refill_after;
+    };
+
+    struct Dial {
+        Host* host;
+        reactor::TimerId timer;
+    };
+
+    // One thread's connections from release_local(). The owning thread
+    // fills and empties slots; the loop thread may take entries back during
+    // maintenance, so whoever touches a slot first claims it by moving its
+    // state to BUSY with a CAS. No locks, and no cache line shared with
+    // other threads on the owner's fast path.
+    struct alignas(64) LocalCache {
+        static constexpr size_t SLOT_COUNT = 8;
+        static constexpr uint32_t EMPTY = 0;
+        static constexpr uint32_t BUSY = 1;
+        static constexpr uint32_t FULL = 2;
+
+        struct Slot {
+            std::atomic<uint32_t> state{EMPTY};
+            uint64_t stamp = 0;     // Higher is more recently released
+            reactor::SocketAddress endpoint;
+            Connection::Ptr connection;
+            std::chrono::steady_clock::time_point since;
+        };
+
+        // nullptr when someone else claimed the slot first
+        Connection::Ptr take(Slot& slot) {
+            uint32_t expected = FULL;
+            if (!slot.state.compare_exchange_strong(expected, BUSY, std::memory_order_acquire)) {
+                return nullptr;
+            }
+            Connection::Ptr connection = std::move(slot.connection);
+            slot.state.store(EMPTY, std::memory_order_release);
+            return connection;
+        }
+
+        std::array<Slot, SLOT_COUNT> slots;
+        uint64_t next_stamp = 0;    // Owner only
+    };
+
+    // Caches are indexed by a process-wide thread number, one bit of free_
+    // each. A thread gives its number back when it exits, and the next
+    // thread to claim it takes over whatever that thread left cached, so
+    // thread churn never exhausts the table. While MAX_LOCAL_CACHES threads
+    // hold numbers, others use the shared pool and retry on each call.
+    static constexpr size_t MAX_LOCAL_CACHES = 64;
+
+    class ThreadNumber {
+    public:
+        static_assert(MAX_LOCAL_CACHES == 64, "free_ has one bit per thread number");
+
+        ThreadNumber() { claim(); }
+
+        ~ThreadNumber() {
+            if (number_ < MAX_LOCAL_CACHES) {
+                free_.fetch_or(uint64_t{1} << number_, std::memory_order_release);
+            }
+        }
 
-    Connection::Ptr acquire() {
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (!idle_connections_.empty()) {
-            auto conn = idle_connections_.front();
-            idle_connections_.pop();
-            return conn;
+        ThreadNumber(const ThreadNumber&) = delete;
+        ThreadNumber& operator=(const ThreadNumber&) = delete;
+
+        // MAX_LOCAL_CACHES when every number is taken. The acquire pairs
+        // with the previous holder's release, so its cache entries are
+        // visible to the new owner.
+        size_t get() {
+            if (number_ == MAX_LOCAL_CACHES) {
+                claim();
+            }
+            return number_;
+        }
+
+    private:
+        void claim() {
+            uint64_t free = free_.load(std::memory_order_relaxed);
+            while (free != 0) {
+                size_t number = static_cast<size_t>(std::countr_zero(free));
+                if (free_.compare_exchange_weak(free, free & ~(uint64_t{1} << number),
+                                                std::memory_order_acquire,
+                                                std::memory_order_relaxed)) {
+                    number_ = number;
+                    return;
+                }
+            }
+        }
+
+        size_t number_ = MAX_LOCAL_CACHES;
+        static inline std::atomic<uint64_t> free_{~uint64_t{0}};
+    };
+
+    static size_t thread_number() {
+        thread_local ThreadNumber number;
+        return number.get();
+    }
+
+    LocalCache* local_cache(bool create) {
+        size_t number = thread_number();
+        if (number >= MAX_LOCAL_CACHES) {
+            return nullptr;
+        }
+        LocalCache* cache = local_caches_[number].load(std::memory_order_acquire);
+        if (!cache && create) {
+            // Only this thread installs its own entry
+            cache = new LocalCache();
+            local_caches_[number].store(cache, std::memory_order_release);
+        }
+        return cache;
+    }
+
+    size_t count_cached() const {
+        size_t count = 0;
+        for (auto& entry : local_caches_) {
+            if (LocalCache* cache = entry.load(std::memory_order_acquire)) {
+                for (auto& slot : cache->slots) {
+                    count += slot.state.load(std::memory_order_relaxed) == LocalCache::FULL;
+                }
+            }
+        }
+        return count;
+    }
+
+    // Moves connections a thread has not reused for a whole interval back
+    // to the shared pool, where other threads and eviction can see them
+    void reclaim_local(std::chrono::steady_clock::time_point now) {
+        for (auto& entry : local_caches_) {
+            LocalCache* cache = entry.load(std::memory_order_acquire);
+            if (!cache) {
+                continue;
+            }
+            for (auto& slot : cache->slots) {
+                uint32_t expected = LocalCache::FULL;
+                if (!slot.state.compare_exchange_strong(expected, LocalCache::BUSY, std::memory_order_acquire)) {
+                    continue;
+                }
+                if (now - slot.since < options_.maintenance_interval) {
+                    slot.state.store(LocalCache::FULL, std::memory_order_release);
+                    continue;
+                }
+                Connection::Ptr connection = std::move(slot.connection);
+                slot.state.store(LocalCache::EMPTY, std::memory_order_release);
+                release_in_loop(std::move(connection));
+            }
+        }
+    }
+
+    Host& host_for(const reactor::SocketAddress& endpoint) {
+        auto& host = hosts_[endpoint.to_string()];
+        if (!host) {
+            host = std::make_unique<Host>();
+            host->address = endpoint;
+            endpoints_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return *host;
+    }
+
+    void acquire_in_loop(Host& host, AcquireCallback callback, std::chrono::milliseconds timeout) {
+        if (auto connection = take_idle(host)) {
+            lease(connection, callback);
+            return;
+        }
+        uint64_t id = next_waiter_id_++;
+        reactor::TimerId timer = reactor::INVALID_TIMER;
+        if (timeout.count() > 0) {
+            timer = loop_.run_after(timeout, [this, &host, id] { expire_waiter(host, id); });
+        }
+        host.waiters.push_back({id, std::move(callback), timer});
+        waiting_.fetch_add(1, std::memory_order_relaxed);
+        // Dials beyond the waiters' share come from fill() alone
+        if (host.open < options_.max_size && host.dialing < host.waiters.size()) {
+            dial(host);
+        }
+    }
+
+    void release_in_loop(Connection::Ptr connection) {
+        auto owner = owners_.find(connection.get());
+        if (owner == owners_.end()) {
+            return;
+        }
+        Host& host = *owner->second;
+        leased_.fetch_sub(1, std::memory_order_relaxed);
+        connection->set_read_callback(nullptr);
+        connection->set_write_callback(nullptr);
+        connection->set_close_callback(nullptr);
+        connection->set_high_water_mark_callback(nullptr, Connection::DEFAULT_HIGH_WATER_MARK);
+        if (!connection->is_connected()) {
+            forget(host, connection.get());
+            if (!host.waiters.empty() && host.open < options_.max_size) {
+                dial(host);
+            }
+            return;
+        }
+        hand_out(host, std::move(connection));
+    }
+
+    // Newest first: it is the least likely to have been closed by the peer
+    Connection::Ptr take_idle(Host& host) {
+        while (!host.idle.empty()) {
+            Connection::Ptr connection = std::move(host.idle.back().connection);
+            host.idle.pop_back();
+            idle_.fetch_sub(1, std::memory_order_relaxed);
+            if (healthy(*connection)) {
+                return connection;
+            }
+            evict(host, connection);
         }
         return nullptr;
     }
 
-    void release(Connection::Ptr conn) {
-        if (!conn || !conn->is_connected()) return;
+    bool healthy(Connection& connection) {
+        return connection.is_connected() && connection.input().empty() &&
+               (!validator_ || validator_(connection));
+    }
+
+    // Gives a ready connection to the oldest waiter, or parks it as idle
+    void hand_out(Host& host, Connection::Ptr connection) {
+        if (host.waiters.empty()) {
+            host.idle.push_back({std::move(connection), std::chrono::steady_clock::now()});
+            idle_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Waiter waiter = std::move(host.waiters.front());
+        host.waiters.pop_front();
+        waiting_.fetch_sub(1, std::memory_order_relaxed);
+        loop_.cancel_timer(waiter.timer);
+        lease(connection, waiter.callback);
+    }
+
+    void lease(const Connection::Ptr& connection, const AcquireCallback& callback) {
+        leased_.fetch_add(1, std::memory_order_relaxed);
+        callback(connection);
+    }
+
+    void expire_waiter(Host& host, uint64_t id) {
+        auto waiter = std::find_if(host.waiters.begin(), host.waiters.end(),
+                                   [id](const Waiter& w) { return w.id == id; });
+        if (waiter == host.waiters.end()) {
+            return;
+        }
+        AcquireCallback callback = std::move(waiter->callback);
+        host.waiters.erase(waiter);
+        waiting_.fetch_sub(1, std::memory_order_relaxed);
+        timeouts_.fetch_add(1, std::memory_order_relaxed);
+        callback(nullptr);
+    }
+
+    // Fails the oldest waiter, the one a failed dial was meant for
+    void fail_waiter(Host& host) {
+        if (host.waiters.empty()) {
+            return;
+        }
+        Waiter waiter = std::move(host.waiters.front());
+        host.waiters.pop_front();
+        waiting_.fetch_sub(1, std::memory_order_relaxed);
+        loop_.cancel_timer(waiter.timer);
+        waiter.callback(nullptr);
+    }
+
+    void dial(Host& host) {
+        ++host.open;
+        ++host.dialing;
+        dialing_.fetch_add(1, std::memory_order_relaxed);
+
+        const reactor::SocketAddress& address = host.address;
+        int fd = socket(address.family(), SOCK_STREAM, 0);
+        if (fd < 0) {
+            dial_failed(host);
+            return;
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        if (!address.is_unix()) {
+            // Pooled connections carry small requests and responses
+            int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+        if (connect(fd, address.data(), address.size()) == 0) {
+            dial_finished(host, fd);
+            return;
+        }
+        if (errno != EINPROGRESS) {
+            close(fd);
+            dial_failed(host);
+            return;
+        }
+        reactor::TimerId timer = loop_.run_after(options_.connect_timeout, [this, fd] {
+            abort_dial(fd);
+        });
+        dials_[fd] = {&host, timer};
+        loop_.register_handler(fd, [this, fd](uint32_t) { complete_dial(fd); }, reactor::EVENT_WRITE);
+    }
+
+    // Writable or failed: SO_ERROR tells which
+    void complete_dial(int fd) {
+        auto dial = dials_.find(fd);
+        if (dial == dials_.end()) {
+            return;
+        }
+        Host& host = *dial->second.host;
+        loop_.cancel_timer(dial->second.timer);
+        dials_.erase(dial);
+        loop_.unregister_handler(fd);
+
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            close(fd);
+            dial_failed(host);
+            return;
+        }
+        dial_finished(host, fd);
+    }
+
+    void abort_dial(int fd) {
+        auto dial = dials_.find(fd);
+        if (dial == dials_.end()) {
+            return;
+        }
+        Host& host = *dial->second.host;
+        dials_.erase(dial);
+        loop_.unregister_handler(fd);
+        close(fd);
+        dial_failed(host);
+    }
+
+    void dial_finished(Host& host, int fd) {
+        --host.dialing;
+        dialing_.fetch_sub(1, std::memory_order_relaxed);
+        created_.fetch_add(1, std::memory_order_relaxed);
+        auto connection = std::make_shared<Connection>(fd, loop_);
+        connection->start();
+        owners_[connection.get()] = &host;
+        hand_out(host, std::move(connection));
+    }
 
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (idle_connections_.size() < max_size_) {
-            idle_connections_.push(conn);
+    void dial_failed(Host& host) {
+        --host.open;
+        --host.dialing;
+        dialing_.fetch_sub(1, std::memory_order_relaxed);
+        dial_failures_.fetch_add(1, std::memory_order_relaxed);
+        host.refill_after = std::chrono::steady_clock::now() + options_.connect_timeout;
+        // Waiters still covered by dials in flight keep waiting for them
+        if (host.dialing < host.waiters.size()) {
+            fail_waiter(host);
         }
     }
 
-    void add_connection(Connection::Ptr conn) {
-        if (!conn || !conn->is_connected()) return;
+    void evict(Host& host, const Connection::Ptr& connection) {
+        evicted_.fetch_add(1, std::memory_order_relaxed);
+        connection->disconnect();
+        forget(host, connection.get());
+    }
+
+    void forget(Host& host, Connection* connection) {
+        owners_.erase(connection);
+        --host.open;
+    }
+
+    // Dials until min_idle connections plus one per waiter are idle or on
+    // their way. The count is fixed up front: a dial that fails at once
+    // must not be retried in a tight loop.
+    void fill(Host& host) {
+        if (std::chrono::steady_clock::now() < host.refill_after) {
+            return;
+        }
+        size_t wanted = options_.min_idle + host.waiters.size();
+        for (size_t have = host.idle.size() + host.dialing; have < wanted && host.open < options_.max_size; ++have) {
+            dial(host);
+        }
+    }
 
-        std::lock_guard<std::mutex> lock(mutex_);
-        if (idle_connections_.size() < max_size_) {
-            idle_connections_.push(conn);
+    void maintain() {
+        auto now = std::chrono::steady_clock::now();
+        reclaim_local(now);
+        for (auto& [key, host] : hosts_) {
+            auto& idle = host->idle;
+            // Oldest first; only the surplus over min_idle may expire
+            size_t kept = 0;
+            size_t removable = idle.size() > options_.min_idle ? idle.size() - options_.min_idle : 0;
+            for (size_t i = 0; i < idle.size(); ++i) {
+                Connection::Ptr& connection = idle[i].connection;
+                bool expired = removable > 0 && now - idle[i].since >= options_.idle_timeout;
+                if (expired || !healthy(*connection)) {
+                    removable -= removable > 0 ? 1 : 0;
+                    idle_.fetch_sub(1, std::memory_order_relaxed);
+                    evict(*host, connection);
+                } else {
+                    idle[kept++] = std::move(idle[i]);
+                }
+            }
+            idle.resize(kept);
+            fill(*host);
         }
     }
 
+    reactor::EventLoop& loop_;
+    ConnectionPoolOptions options_;
+    Validator validator_;
+    std::unordered_map<std::string, std::unique_ptr<Host>> hosts_;
+    std::unordered_map<const Connection*, Host*> owners_;
+    std::unordered_map<int, Dial> dials_;
+    std::array<std::atomic<LocalCache*>, MAX_LOCAL_CACHES> local_caches_{};
+    reactor::TimerId maintenance_timer_ = reactor::INVALID_TIMER;
+    uint64_t next_waiter_id_ = 0;
+
+    std::atomic<size_t> endpoints_{0};
+    std::atomic<size_t> idle_{0};
+    std::atomic<size_t> leased_{0};
+    std::atomic<size_t> dialing_{0};
+    std::atomic<size_t> waiting_{0};
+    std::atomic<size_t> created_{0};
+    std::atomic<size_t> dial_failures_{0};
+    std::atomic<size_t> evicted_{0};
+    std::atomic<size_t> timeouts_{0};
+};
+
+// Resumes on the loop thread with the connection, or nullptr on failure
+class ConnectionPool::AcquireOperation {
+public:
+    AcquireOperation(ConnectionPool& pool, const reactor::SocketAddress& endpoint)
+        : pool_(pool), endpoint_(endpoint) {}
+
+    bool await_ready() const { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        // The callback may run before acquire() returns; nothing here
+        // touches this afterwards
+        pool_.acquire(endpoint_, [this, handle](Connection::Ptr connection) {
+            result_ = std::move(connection);
+            handle.resume();
+        });
+    }
+
+    Connection::Ptr await_resume() {
+        return std::move(result_);
+    }
+
 private:
-    size_t max_size_;
-    std::mutex mutex_;
-    std::queue<Connection::Ptr> idle_connections_;
+    ConnectionPool& pool_;
+    reactor::SocketAddress endpoint_;
+    Connection::Ptr result_;
 };
 
+inline ConnectionPool::AcquireOperation ConnectionPool::async_acquire(const reactor::SocketAddress& endpoint) {
+    return AcquireOperation(*this, endpoint);
+}
+
 } // namespace async_toolkit::network
+
+#endif
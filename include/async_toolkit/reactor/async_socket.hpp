@@ -0,0 +1,469 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include "event_loop.hpp"
+#include "socket_address.hpp"
+
+#ifndef _WIN32
+
+namespace async_toolkit::reactor {
+
+// Non-blocking socket on an EventLoop whose operations are awaited from a
+// coroutine (coroutine::Task or any other coroutine type):
+//
+//     size_t n = co_await socket->async_read(buffer);
+//
+// Each operation tries its syscall first and suspends only if it would
+// block; the socket's event handler then resumes the coroutine on the loop
+// thread. A coroutine already running on the loop thread never changes
+// thread; one awaiting from another thread moves to the loop once.
+//
+// Failures are thrown from co_await as std::system_error, including
+// ETIMEDOUT when an operation's timeout expires and ECANCELED after
+// cancel(). At most one read-side (read, accept) and one write-side
+// (write, connect) operation may be pending; another one fails with EBUSY.
+// Create and destroy sockets on the loop thread, or before it runs.
+class AsyncSocket {
+public:
+    using Ptr = std::unique_ptr<AsyncSocket>;
+
+    // Timeout value meaning "wait as long as it takes"
+    static constexpr std::chrono::milliseconds NO_TIMEOUT{0};
+
+    // Takes ownership of fd and makes it non-blocking
+    AsyncSocket(EventLoop& loop, FileDescriptor fd) : loop_(loop), fd_(fd) {
+        int flags = fcntl(fd_, F_GETFL, 0);
+        if (flags >= 0 && !(flags & O_NONBLOCK)) {
+            fcntl(fd_, F_SETFL, flags | O_NONBLOCK);
+        }
+        // Edge-triggered, so write readiness costs nothing while no write waits
+        loop_.register_handler(fd_, [this](uint32_t events) { handle_events(events); },
+                               EVENT_READ | EVENT_WRITE);
+    }
+
+    // Pending operations finish with ECANCELED before the fd closes
+    ~AsyncSocket() {
+        Operation* reader = detach(reader_);
+        Operation* writer = detach(writer_);
+        for (Operation* op : {reader, writer}) {
+            if (op) {
+                op->socket_ = nullptr;
+                op->error_ = ECANCELED;
+            }
+        }
+        loop_.unregister_handler(fd_);
+        close(fd_);
+        resume(reader);
+        resume(writer);
+    }
+
+    AsyncSocket(const AsyncSocket&) = delete;
+    AsyncSocket& operator=(const AsyncSocket&) = delete;
+
+    // Listening socket for async_accept
+    static Ptr listen(EventLoop& loop, const SocketAddress& address, int backlog = SOMAXCONN) {
+        int fd = socket(address.family(), SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "socket");
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        int enable = 1;
+        if (!address.is_unix()) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        }
+        if (bind(fd, address.data(), address.size()) != 0 || ::listen(fd, backlog) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "listen on " + address.to_string());
+        }
+        return std::make_unique<AsyncSocket>(loop, fd);
+    }
+
+    class ReadOperation;
+    class WriteOperation;
+    class AcceptOperation;
+    class ConnectOperation;
+
+    // Reads what is available into buffer, at most its size; 0 means the
+    // peer closed
+    ReadOperation async_read(std::span<char> buffer, std::chrono::milliseconds timeout = NO_TIMEOUT);
+
+    // Writes all of data, waiting for socket buffer space as needed
+    WriteOperation async_write(std::span<const char> data, std::chrono::milliseconds timeout = NO_TIMEOUT);
+
+    // Next connection on a listen() socket, as a socket on the same loop
+    AcceptOperation async_accept(std::chrono::milliseconds timeout = NO_TIMEOUT);
+
+    // Connected socket on loop
+    static ConnectOperation async_connect(EventLoop& loop, const SocketAddress& address,
+                                          std::chrono::milliseconds timeout = NO_TIMEOUT);
+
+    // Finishes pending operations with ECANCELED. Safe from any thread, as
+    // long as the socket outlives the call.
+    void cancel() {
+        loop_.run_in_loop([this] {
+            Operation* reader = detach(reader_);
+            Operation* writer = detach(writer_);
+            for (Operation* op : {reader, writer}) {
+                if (op) {
+                    op->error_ = ECANCELED;
+                }
+            }
+            resume(reader);
+            resume(writer);
+        });
+    }
+
+    SocketAddress local_address() const {
+        sockaddr_storage address;
+        socklen_t length = sizeof(address);
+        getsockname(fd_, reinterpret_cast<sockaddr*>(&address), &length);
+        return SocketAddress::from(reinterpret_cast<sockaddr*>(&address), length);
+    }
+
+    SocketAddress peer_address() const {
+        sockaddr_storage address;
+        socklen_t length = sizeof(address);
+        if (getpeername(fd_, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            return SocketAddress();
+        }
+        return SocketAddress::from(reinterpret_cast<sockaddr*>(&address), length);
+    }
+
+    FileDescriptor fd() const { return fd_; }
+    EventLoop& loop() { return loop_; }
+
+private:
+    enum class Side {
+        READ,
+        WRITE
+    };
+
+    // State shared by every awaitable. It lives in the awaiting coroutine's
+    // frame, and the socket points at it while the coroutine is suspended.
+    class Operation {
+    public:
+        Operation(const Operation&) = delete;
+        Operation& operator=(const Operation&) = delete;
+
+        bool await_ready() {
+            hop_ = !loop_.is_in_loop_thread();
+            return !hop_ && start();
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            handle_ = handle;
+            if (!hop_) {
+                socket_->park(*this);
+                return;
+            }
+            // The coroutine may be destroyed before the loop gets to it
+            hop_token_ = std::make_shared<char>();
+            loop_.run_in_loop([this, token = std::weak_ptr<char>(hop_token_)] {
+                if (token.expired()) {
+                    return;
+                }
+                if (start()) {
+                    handle_.resume();
+                } else {
+                    socket_->park(*this);
+                }
+            });
+        }
+
+    protected:
+        Operation(EventLoop& loop, AsyncSocket* socket, Side side, std::chrono::milliseconds timeout)
+            : loop_(loop), socket_(socket), side_(side), timeout_(timeout) {}
+
+        // A coroutine destroyed while suspended must not be resumed later
+        ~Operation() {
+            abandon();
+        }
+
+        void abandon() {
+            if (parked_) {
+                socket_->detach(socket_->slot(side_));
+            }
+        }
+
+        // Performs the syscall on the loop thread; false if it would block.
+        // On completion the result or error_ is set.
+        virtual bool attempt() = 0;
+
+        void check() const {
+            if (error_ != 0) {
+                throw std::system_error(error_, std::generic_category());
+            }
+        }
+
+        EventLoop& loop_;
+        AsyncSocket* socket_;
+        int error_ = 0;
+
+    private:
+        friend class AsyncSocket;
+
+        // On the loop thread: true when finished without waiting
+        bool start() {
+            if (socket_ && socket_->slot(side_)) {
+                error_ = EBUSY;
+                return true;
+            }
+            return attempt();
+        }
+
+        Side side_;
+        std::chrono::milliseconds timeout_;
+        std::coroutine_handle<> handle_;
+        TimerId timer_ = INVALID_TIMER;
+        bool hop_ = false;
+        bool parked_ = false;   // The socket points at this operation
+        std::shared_ptr<char> hop_token_;
+    };
+
+    Operation*& slot(Side side) {
+        return side == Side::READ ? reader_ : writer_;
+    }
+
+    void park(Operation& op) {
+        slot(op.side_) = &op;
+        op.parked_ = true;
+        if (op.timeout_ > NO_TIMEOUT) {
+            op.timer_ = loop_.run_after(op.timeout_, [this, &op] {
+                op.timer_ = INVALID_TIMER;
+                if (slot(op.side_) == &op) {
+                    detach(slot(op.side_));
+                    op.error_ = ETIMEDOUT;
+                    op.handle_.resume();
+                }
+            });
+        }
+    }
+
+    Operation* detach(Operation*& slot) {
+        Operation* op = std::exchange(slot, nullptr);
+        if (op) {
+            op->parked_ = false;
+            stop_timer(*op);
+        }
+        return op;
+    }
+
+    void stop_timer(Operation& op) {
+        if (op.timer_ != INVALID_TIMER) {
+            loop_.cancel_timer(op.timer_);
+            op.timer_ = INVALID_TIMER;
+        }
+    }
+
+    static void resume(Operation* op) {
+        if (op) {
+            op->handle_.resume();
+        }
+    }
+
+    // Both sides are settled before either coroutine runs: a resumed
+    // coroutine may destroy this socket
+    void handle_events(uint32_t events) {
+        constexpr uint32_t failure = EVENT_ERROR | EVENT_HANGUP;
+        Operation* reader = nullptr;
+        Operation* writer = nullptr;
+        if (reader_ && (events & (EVENT_READ | failure)) && reader_->attempt()) {
+            reader = detach(reader_);
+        }
+        if (writer_ && (events & (EVENT_WRITE | failure)) && writer_->attempt()) {
+            writer = detach(writer_);
+        }
+        resume(reader);
+        resume(writer);
+    }
+
+    EventLoop& loop_;
+    FileDescriptor fd_;
+    Operation* reader_ = nullptr;
+    Operation* writer_ = nullptr;
+};
+
+class AsyncSocket::ReadOperation : public Operation {
+public:
+    ReadOperation(AsyncSocket& socket, std::span<char> buffer, std::chrono::milliseconds timeout)
+        : Operation(socket.loop_, &socket, Side::READ, timeout), buffer_(buffer) {}
+
+    size_t await_resume() {
+        check();
+        return result_;
+    }
+
+private:
+    bool attempt() override {
+        while (true) {
+            ssize_t n = read(socket_->fd_, buffer_.data(), buffer_.size());
+            if (n >= 0) {
+                result_ = static_cast<size_t>(n);
+                return true;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return false;
+            }
+            if (errno != EINTR) {
+                error_ = errno;
+                return true;
+            }
+        }
+    }
+
+    std::span<char> buffer_;
+    size_t result_ = 0;
+};
+
+class AsyncSocket::WriteOperation : public Operation {
+public:
+    WriteOperation(AsyncSocket& socket, std::span<const char> data, std::chrono::milliseconds timeout)
+        : Operation(socket.loop_, &socket, Side::WRITE, timeout), data_(data) {}
+
+    size_t await_resume() {
+        check();
+        return written_;
+    }
+
+private:
+    bool attempt() override {
+#ifdef MSG_NOSIGNAL
+        constexpr int flags = MSG_NOSIGNAL;
+#else
+        constexpr int flags = 0;
+#endif
+        while (written_ < data_.size()) {
+            ssize_t n = ::send(socket_->fd_, data_.data() + written_, data_.size() - written_, flags);
+            if (n >= 0) {
+                written_ += static_cast<size_t>(n);
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return false;
+            } else if (errno != EINTR) {
+                error_ = errno;
+                return true;
+            }
+        }
+        return true;
+    }
+
+    std::span<const char> data_;
+    size_t written_ = 0;
+};
+
+class AsyncSocket::AcceptOperation : public Operation {
+public:
+    AcceptOperation(AsyncSocket& socket, std::chrono::milliseconds timeout)
+        : Operation(socket.loop_, &socket, Side::READ, timeout) {}
+
+    Ptr await_resume() {
+        check();
+        return std::move(result_);
+    }
+
+private:
+    bool attempt() override {
+        while (true) {
+#ifdef __linux__
+            int fd = accept4(socket_->fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+            int fd = accept(socket_->fd_, nullptr, nullptr);
+            if (fd >= 0) {
+                fcntl(fd, F_SETFD, FD_CLOEXEC);
+            }
+#endif
+            if (fd >= 0) {
+                result_ = std::make_unique<AsyncSocket>(loop_, fd);
+                return true;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return false;
+            }
+            if (errno != EINTR && errno != ECONNABORTED) {
+                error_ = errno;
+                return true;
+            }
+        }
+    }
+
+    Ptr result_;
+};
+
+// Creates its socket on the loop thread, once the operation runs there
+class AsyncSocket::ConnectOperation : public Operation {
+public:
+    ConnectOperation(EventLoop& loop, const SocketAddress& address, std::chrono::milliseconds timeout)
+        : Operation(loop, nullptr, Side::WRITE, timeout), address_(address) {}
+
+    ~ConnectOperation() {
+        // Before result_ goes, while the socket still knows this operation
+        abandon();
+    }
+
+    Ptr await_resume() {
+        check();
+        return std::move(result_);
+    }
+
+private:
+    bool attempt() override {
+        if (result_) {
+            // Writable: the handshake finished one way or the other
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(result_->fd_, SOL_SOCKET, SO_ERROR, &error, &length);
+            error_ = error;
+            return true;
+        }
+        int fd = socket(address_.family(), SOCK_STREAM, 0);
+        if (fd < 0) {
+            error_ = errno;
+            return true;
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        result_ = std::make_unique<AsyncSocket>(loop_, fd);
+        socket_ = result_.get();
+        if (connect(fd, address_.data(), address_.size()) == 0) {
+            return true;
+        }
+        if (errno == EINPROGRESS || errno == EINTR) {
+            return false;
+        }
+        error_ = errno;
+        return true;
+    }
+
+    SocketAddress address_;
+    Ptr result_;
+};
+
+inline AsyncSocket::ReadOperation AsyncSocket::async_read(std::span<char> buffer,
+                                                          std::chrono::milliseconds timeout) {
+    return ReadOperation(*this, buffer, timeout);
+}
+
+inline AsyncSocket::WriteOperation AsyncSocket::async_write(std::span<const char> data,
+                                                            std::chrono::milliseconds timeout) {
+    return WriteOperation(*this, data, timeout);
+}
+
+inline AsyncSocket::AcceptOperation AsyncSocket::async_accept(std::chrono::milliseconds timeout) {
+    return AcceptOperation(*this, timeout);
+}
+
+inline AsyncSocket::ConnectOperation AsyncSocket::async_connect(EventLoop& loop, const SocketAddress& address,
+                                                                std::chrono::milliseconds timeout) {
+    return ConnectOperation(loop, address, timeout);
+}
+
+} // namespace async_toolkit::reactor
+
+#endif
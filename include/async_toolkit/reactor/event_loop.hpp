@@ -1,14 +1,24 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <memory>
 #include <functional>
-#include <unordered_map>
+#include <cstdint>
 #include <vector>
 #include <chrono>
 #include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <cstring>
+#include <cerrno>
 #include "../executor/thread_pool_executor.hpp"
 
 #ifdef _WIN32
@@ -17,9 +27,17 @@
 #pragma comment(lib, "ws2_32.lib")
 #else
 #include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
 #endif
+#include "io_uring.hpp"
+#include "socket_address.hpp"
 
 namespace async_toolkit::reactor {
 
@@ -31,19 +49,357 @@ using FileDescriptor =
 #endif
 ;
 
+// Readiness bits, used both as the interest set of a channel and as the
+// mask handed to its callback
+enum EventMask : uint32_t {
+    EVENT_NONE = 0,
+    EVENT_READ = 1 << 0,
+    EVENT_WRITE = 1 << 1,
+    EVENT_ERROR = 1 << 2,   // Always reported, cannot be masked
+    EVENT_HANGUP = 1 << 3   // Peer closed or shut down its write side
+};
+
+using EventCallback = std::function<void(uint32_t events)>;
+
+// Kernel interface behind an EventLoop. AUTO picks io_uring when the kernel
+// supports it and falls back to epoll otherwise.
+enum class Backend {
+    EPOLL,
+    IO_URING,
+    AUTO
+};
+
+#ifdef ASYNC_TOOLKIT_HAS_IO_URING
+// Target of a completion operation: a plain fd, or a slot in the table
+// installed with register_files(), which skips the per-operation fd lookup
+struct IoFile {
+    IoFile(FileDescriptor descriptor) : fd(descriptor) {}
+
+    static IoFile fixed(unsigned index) {
+        IoFile file(static_cast<FileDescriptor>(index));
+        file.is_fixed = true;
+        return file;
+    }
+
+    FileDescriptor fd;
+    bool is_fixed = false;
+};
+#endif
+
+// Per-fd registration: callback and interest set. Channels live in a
+// ChannelTable indexed directly by fd, so dispatching an event is one
+// array lookup rather than a pointer stored in the kernel.
+struct Channel {
+    EventCallback callback;
+    EventCallback replacement;   // Registered from inside its own callback
+    uint32_t interest = EVENT_NONE;
+    uint32_t generation = 0;     // Bumped on unregister, drops stale events
+    bool registered = false;
+    bool dispatching = false;
+    bool replace = false;
+};
+
+// Slab of channels in fixed-size chunks, allocated on first use. Chunks
+// never move, so references stay valid while the table grows.
+class ChannelTable {
+public:
+    static constexpr size_t CHUNK_SIZE = 1024;
+
+    Channel& operator[](FileDescriptor fd) {
+        size_t index = static_cast<size_t>(fd);
+        size_t chunk = index / CHUNK_SIZE;
+        if (chunk >= chunks_.size()) {
+            chunks_.resize(chunk + 1);
+        }
+        if (!chunks_[chunk]) {
+            chunks_[chunk] = std::make_unique<Channel[]>(CHUNK_SIZE);
+        }
+        return chunks_[chunk][index % CHUNK_SIZE];
+    }
+
+    Channel* find(FileDescriptor fd) {
+        size_t index = static_cast<size_t>(fd);
+        size_t chunk = index / CHUNK_SIZE;
+        if (chunk >= chunks_.size() || !chunks_[chunk]) {
+            return nullptr;
+        }
+        return &chunks_[chunk][index % CHUNK_SIZE];
+    }
+
+private:
+    std::vector<std::unique_ptr<Channel[]>> chunks_;
+};
+
+using TimerCallback = std::function<void()>;
+
+// Handle returned by timer registration; generation in the high half makes
+// a stale id harmless once its slot is reused
+using TimerId = uint64_t;
+constexpr TimerId INVALID_TIMER = 0;
+
+// Hashed timing wheel with 1ms ticks. A timer due at tick t sits in slot
+// t % SLOTS on an intrusive list, so add and cancel are O(1); timers more
+// than one revolution away stay in their slot until their tick comes round.
+// Nodes live in a deque (stable addresses) with a free list. Not
+// thread-safe; EventLoop guards it with its timer mutex.
+class TimerWheel {
+public:
+    static constexpr size_t SLOTS = 1024;
+
+    explicit TimerWheel(uint64_t now_tick = 0) : current_(now_tick) {
+        heads_.fill(NIL);
+    }
+
+    TimerId add(uint64_t expiry, uint64_t period, TimerCallback callback) {
+        uint32_t index;
+        if (free_ != NIL) {
+            index = free_;
+            free_ = nodes_[index].next;
+        } else {
+            index = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        Node& node = nodes_[index];
+        node.callback = std::move(callback);
+        node.period = period;
+        node.firing = false;
+        node.cancelled = false;
+        node.in_use = true;
+        link(index, std::max(expiry, current_ + 1));
+        ++active_;
+        return (static_cast<uint64_t>(node.generation) << 32) | index;
+    }
+
+    // False if the timer already fired (one-shot) or was cancelled. A timer
+    // cancelled while its callback runs is released once the callback returns.
+    bool cancel(TimerId id) {
+        Node* node = lookup(id);
+        if (!node || node->cancelled) {
+            return false;
+        }
+        --active_;
+        if (node->firing) {
+            node->cancelled = true;
+            return true;
+        }
+        unlink(static_cast<uint32_t>(id));
+        release(static_cast<uint32_t>(id));
+        return true;
+    }
+
+    // Unlinks every timer due at or before now and marks it firing; the
+    // caller runs the callbacks and then calls rearm() for each one
+    void expire(uint64_t now, std::vector<uint32_t>& due) {
+        if (now <= current_) {
+            return;
+        }
+        uint64_t steps = std::min<uint64_t>(now - current_, SLOTS);
+        for (uint64_t i = 1; i <= steps; ++i) {
+            size_t slot = (current_ + i) % SLOTS;
+            uint32_t index = heads_[slot];
+            while (index != NIL) {
+                uint32_t next = nodes_[index].next;
+                if (nodes_[index].expiry <= now) {
+                    unlink(index);
+                    nodes_[index].firing = true;
+                    due.push_back(index);
+                }
+                index = next;
+            }
+        }
+        current_ = now;
+    }
+
+    TimerCallback& callback(uint32_t index) {
+        return nodes_[index].callback;
+    }
+
+    // Reschedules a fired periodic timer, releases everything else
+    void rearm(uint32_t index, uint64_t now) {
+        Node& node = nodes_[index];
+        node.firing = false;
+        if (node.cancelled || node.period == 0) {
+            if (!node.cancelled) {
+                --active_;
+            }
+            release(index);
+            return;
+        }
+        link(index, std::max(node.expiry + node.period, now + 1));
+    }
+
+    // Tick of the first occupied slot; timers there may belong to a later
+    // revolution, in which case the wakeup finds nothing due and re-arms
+    std::optional<uint64_t> next_expiry() const {
+        if (active_ == 0) {
+            return std::nullopt;
+        }
+        for (uint64_t i = 1; i <= SLOTS; ++i) {
+            uint32_t index = heads_[(current_ + i) % SLOTS];
+            if (index != NIL) {
+                uint64_t earliest = UINT64_MAX;
+                for (; index != NIL; index = nodes_[index].next) {
+                    earliest = std::min(earliest, nodes_[index].expiry);
+                }
+                return std::min(earliest, current_ + i);
+            }
+        }
+        return std::nullopt;
+    }
+
+    size_t size() const { return active_; }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        TimerCallback callback;
+        uint64_t expiry = 0;
+        uint64_t period = 0;
+        uint32_t prev = NIL;
+        uint32_t next = NIL;
+        uint32_t generation = 1;
+        bool in_use = false;
+        bool firing = false;
+        bool cancelled = false;
+    };
+
+    Node* lookup(TimerId id) {
+        auto index = static_cast<uint32_t>(id);
+        auto generation = static_cast<uint32_t>(id >> 32);
+        if (index >= nodes_.size() || !nodes_[index].in_use ||
+            nodes_[index].generation != generation) {
+            return nullptr;
+        }
+        return &nodes_[index];
+    }
+
+    void link(uint32_t index, uint64_t expiry) {
+        Node& node = nodes_[index];
+        node.expiry = expiry;
+        uint32_t& head = heads_[expiry % SLOTS];
+        node.prev = NIL;
+        node.next = head;
+        if (head != NIL) {
+            nodes_[head].prev = index;
+        }
+        head = index;
+    }
+
+    void unlink(uint32_t index) {
+        Node& node = nodes_[index];
+        if (node.prev != NIL) {
+            nodes_[node.prev].next = node.next;
+        } else {
+            heads_[node.expiry % SLOTS] = node.next;
+        }
+        if (node.next != NIL) {
+            nodes_[node.next].prev = node.prev;
+        }
+        node.prev = node.next = NIL;
+    }
+
+    void release(uint32_t index) {
+        Node& node = nodes_[index];
+        node.callback = nullptr;
+        node.in_use = false;
+        ++node.generation;
+        if (node.generation == 0) {
+            node.generation = 1;
+        }
+        node.next = free_;
+        free_ = index;
+    }
+
+    std::array<uint32_t, SLOTS> heads_;
+    std::deque<Node> nodes_;
+    uint32_t free_ = NIL;
+    uint64_t current_;
+    size_t active_ = 0;
+};
+
+// Edge-triggered reactor. Handler registration and modification must happen
+// on the loop thread, or before run() starts; other threads hand work to the
+// loop with run_in_loop/queue_in_loop. Timers may be added and cancelled
+// from any thread.
+//
+// With the io_uring backend, handlers are served by multishot poll requests
+// and every SQE queued during an iteration goes to the kernel in the single
+// io_uring_enter that also waits for the next completions. The submit_*
+// operations expose io_uring directly: the kernel performs the I/O and the
+// callback gets the result, and submit_recv() reads straight into buffers
+// the loop provides, without a readiness round trip or an extra copy.
 class EventLoop {
 public:
-    using EventCallback = std::function<void()>;
-    using TimerCallback = std::function<void()>;
+    using EventCallback = reactor::EventCallback;
+    using TimerCallback = reactor::TimerCallback;
+    using OperationId = uint64_t;
+    using CompletionCallback = std::function<void(int result)>;   // Bytes, fd, or -errno
+    using BufferCallback = std::function<void(int result, std::span<const char> data)>;
+    using Functor = executor::UniqueFunction<void()>;
 
-    EventLoop()
-        : running_(false) {
+    explicit EventLoop(Backend backend = Backend::EPOLL)
+        : running_(false),
+          start_time_(std::chrono::steady_clock::now()) {
 #ifdef _WIN32
+        if (backend == Backend::IO_URING) {
+            throw std::runtime_error("io_uring backend is not available on this platform");
+        }
         WSADATA wsa_data;
         WSAStartup(MAKEWORD(2, 2), &wsa_data);
         event_handle_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0);
 #else
-        epoll_fd_ = epoll_create1(0);
+#ifdef ASYNC_TOOLKIT_HAS_IO_URING
+        if (backend != Backend::EPOLL) {
+            try {
+                ring_ = std::make_unique<IoUring>();
+            } catch (const std::exception&) {
+                if (backend == Backend::IO_URING) {
+                    throw;
+                }
+            }
+        }
+#else
+        if (backend == Backend::IO_URING) {
+            throw std::runtime_error("io_uring backend is not available in this build");
+        }
+#endif
+        if (!uses_io_uring()) {
+            epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+            if (epoll_fd_ < 0) {
+                throw std::runtime_error(std::string("epoll_create1 failed: ") + std::strerror(errno));
+            }
+        }
+        // Timers wake the loop through a timerfd armed for the wheel's next
+        // deadline, so they fire on time instead of at the next epoll timeout
+        timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd_ < 0) {
+            int error = errno;
+            if (epoll_fd_ >= 0) {
+                close(epoll_fd_);
+            }
+            throw std::runtime_error(std::string("timerfd_create failed: ") + std::strerror(error));
+        }
+        register_handler(timer_fd_, [this](uint32_t) {
+            uint64_t expirations;
+            while (read(timer_fd_, &expirations, sizeof(expirations)) > 0) {
+            }
+            process_timers();
+        });
+        wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeup_fd_ < 0) {
+            int error = errno;
+            close(timer_fd_);
+            if (epoll_fd_ >= 0) {
+                close(epoll_fd_);
+            }
+            throw std::runtime_error(std::string("eventfd failed: ") + std::strerror(error));
+        }
+        register_handler(wakeup_fd_, [this](uint32_t) {
+            uint64_t count;
+            while (read(wakeup_fd_, &count, sizeof(count)) > 0) {
+            }
+        });
 #endif
     }
 
@@ -52,63 +408,303 @@ public:
         CloseHandle(event_handle_);
         WSACleanup();
 #else
-        close(epoll_fd_);
+        close(wakeup_fd_);
+        close(timer_fd_);
+        if (epoll_fd_ >= 0) {
+            close(epoll_fd_);
+        }
 #endif
     }
 
+    Backend backend() const {
+        return uses_io_uring() ? Backend::IO_URING : Backend::EPOLL;
+    }
+
     void run() {
+        thread_id_.store(std::this_thread::get_id(), std::memory_order_release);
         running_ = true;
         while (running_) {
+#ifdef _WIN32
             process_timers();
+#endif
             process_events();
+            run_pending_functors();
         }
+        thread_id_.store(std::thread::id(), std::memory_order_release);
     }
 
+    // Thread-safe. A loop that has not entered run() yet would reset the
+    // flag; queue_in_loop([&loop] { loop.stop(); }) works in every state.
     void stop() {
         running_ = false;
+        if (!is_in_loop_thread()) {
+            wakeup();
+        }
+    }
+
+    bool is_in_loop_thread() const {
+        return thread_id_.load(std::memory_order_acquire) == std::this_thread::get_id();
+    }
+
+    // Runs functor now when called on the loop thread, otherwise queues it
+    void run_in_loop(Functor functor) {
+        if (is_in_loop_thread()) {
+            functor();
+        } else {
+            queue_in_loop(std::move(functor));
+        }
+    }
+
+    // Queues functor to run on the loop thread after the current batch of
+    // events. Callers off the loop thread wake it through an eventfd, but
+    // only when the queue was empty: a non-empty queue is already due to be
+    // drained. A functor queued by another functor runs next iteration.
+    void queue_in_loop(Functor functor) {
+        bool was_empty;
+        {
+            std::lock_guard<std::mutex> lock(functor_mutex_);
+            was_empty = pending_functors_.empty();
+            pending_functors_.push_back(std::move(functor));
+        }
+        if (is_in_loop_thread() ? calling_functors_ : was_empty) {
+            wakeup();
+        }
+    }
+
+    // Registered handlers, the loop's own timer and wakeup fds included;
+    // EventLoopGroup reads it from other threads to find the least loaded loop
+    size_t handler_count() const {
+        return handler_count_.load(std::memory_order_relaxed);
     }
 
-    // 注册IO事件处理器
-    void register_handler(FileDescriptor fd, EventCallback callback) {
+    // 注册IO事件处理器. callback receives the EventMask bits that are ready;
+    // handlers must drain the fd since notifications are edge-triggered.
+    void register_handler(FileDescriptor fd, EventCallback callback,
+                          uint32_t interest = EVENT_READ) {
+        Channel& channel = channels_[fd];
+        if (channel.registered) {
+            throw std::runtime_error("Handler already registered for fd");
+        }
 #ifdef _WIN32
-        CreateIoCompletionPort((HANDLE)fd, event_handle_, 
-                             (ULONG_PTR)new EventCallback(callback), 0);
+        if (!CreateIoCompletionPort((HANDLE)fd, event_handle_, (ULONG_PTR)fd, 0)) {
+            throw std::runtime_error("Failed to associate socket with completion port");
+        }
 #else
-        epoll_event event;
-        event.events = EPOLLIN | EPOLLET;
-        event.data.ptr = new EventCallback(callback);
-        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+        if (uses_io_uring()) {
+            arm_poll(fd, interest, channel.generation);
+        } else {
+            epoll_event event = make_event(fd, interest, channel.generation);
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+                throw std::runtime_error(std::string("epoll_ctl ADD failed: ") + std::strerror(errno));
+            }
+        }
+#endif
+        if (channel.dispatching) {
+            channel.replacement = std::move(callback);
+            channel.replace = true;
+        } else {
+            channel.callback = std::move(callback);
+        }
+        channel.interest = interest;
+        channel.registered = true;
+        handler_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Replaces the interest set of a registered fd
+    void modify_handler(FileDescriptor fd, uint32_t interest) {
+        Channel* channel = channels_.find(fd);
+        if (!channel || !channel->registered) {
+            throw std::runtime_error("No handler registered for fd");
+        }
+        if (channel->interest == interest) {
+            return;
+        }
+#ifndef _WIN32
+        if (uses_io_uring()) {
+            // A fresh poll request reports current readiness immediately,
+            // so replacing the old one cannot lose an edge
+            cancel_poll(fd, channel->generation);
+            ++channel->generation;
+            arm_poll(fd, interest, channel->generation);
+        } else {
+            epoll_event event = make_event(fd, interest, channel->generation);
+            if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event) < 0) {
+                throw std::runtime_error(std::string("epoll_ctl MOD failed: ") + std::strerror(errno));
+            }
+        }
 #endif
-        handlers_[fd] = callback;
+        channel->interest = interest;
     }
 
-    // 注册定时器
-    void register_timer(std::chrono::milliseconds delay, TimerCallback callback,
-                       bool periodic = false) {
-        auto deadline = std::chrono::steady_clock::now() + delay;
+    // Safe to call from inside the fd's own callback; events for the fd
+    // already fetched in the current batch are dropped. Call it before
+    // closing the fd.
+    void unregister_handler(FileDescriptor fd) {
+        Channel* channel = channels_.find(fd);
+        if (!channel || !channel->registered) {
+            return;
+        }
+#ifndef _WIN32
+        if (uses_io_uring()) {
+            cancel_poll(fd, channel->generation);
+        } else {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        }
+#endif
+        channel->registered = false;
+        handler_count_.fetch_sub(1, std::memory_order_relaxed);
+        channel->interest = EVENT_NONE;
+        ++channel->generation;
+        channel->replace = false;
+        channel->replacement = nullptr;
+        if (!channel->dispatching) {
+            channel->callback = nullptr;
+        }
+    }
+
+    bool has_handler(FileDescriptor fd) {
+        Channel* channel = channels_.find(fd);
+        return channel && channel->registered;
+    }
+
+    // 注册定时器. Fires after delay (rounded up to the next millisecond),
+    // then every delay if periodic; returns an id for cancel_timer.
+    TimerId register_timer(std::chrono::milliseconds delay, TimerCallback callback,
+                           bool periodic = false) {
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+        auto ticks = static_cast<uint64_t>(std::max<int64_t>(delay.count(), 1));
+        // +1 because the current tick is already partly elapsed
+        uint64_t expiry = current_tick() + ticks + 1;
+        TimerId id = wheel_.add(expiry, periodic ? ticks : 0, std::move(callback));
+        if (expiry < armed_tick_) {
+            arm_at_locked(expiry);
+        }
+        return id;
+    }
+
+    TimerId run_after(std::chrono::milliseconds delay, TimerCallback callback) {
+        return register_timer(delay, std::move(callback));
+    }
+
+    TimerId run_every(std::chrono::milliseconds period, TimerCallback callback) {
+        return register_timer(period, std::move(callback), true);
+    }
+
+    // 取消定时器. False if the timer already fired or was cancelled; safe to
+    // call from inside the timer's own callback.
+    bool cancel_timer(TimerId id) {
         std::lock_guard<std::mutex> lock(timer_mutex_);
-        timers_.push({deadline, callback, delay, periodic});
-        timer_cv_.notify_one();
+        return wheel_.cancel(id);
     }
 
-    // 取消定时器
-    void cancel_timer(const TimerCallback& callback) {
+    size_t pending_timers() {
         std::lock_guard<std::mutex> lock(timer_mutex_);
-        // 实现定时器取消逻辑
+        return wheel_.size();
     }
 
-private:
-    struct Timer {
-        std::chrono::steady_clock::time_point deadline;
-        TimerCallback callback;
-        std::chrono::milliseconds period;
-        bool periodic;
+#ifdef ASYNC_TOOLKIT_HAS_IO_URING
+    // Completion operations, io_uring backend only, called on the loop
+    // thread. Buffers must stay valid until the callback runs. Reads and
+    // writes use the file position for seekable files.
+    OperationId submit_read(IoFile file, void* buffer, size_t length, CompletionCallback callback) {
+        io_uring_sqe* sqe = prepare(IORING_OP_READ, file, std::move(callback));
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        sqe->len = static_cast<uint32_t>(length);
+        sqe->off = static_cast<uint64_t>(-1);
+        return sqe->user_data;
+    }
 
-        bool operator>(const Timer& other) const {
-            return deadline > other.deadline;
+    OperationId submit_write(IoFile file, const void* buffer, size_t length, CompletionCallback callback) {
+        io_uring_sqe* sqe = prepare(IORING_OP_WRITE, file, std::move(callback));
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        sqe->len = static_cast<uint32_t>(length);
+        sqe->off = static_cast<uint64_t>(-1);
+        return sqe->user_data;
+    }
+
+    // Same as submit_read/submit_write, on memory inside buffer buffer_index
+    // of register_buffers(), which the kernel has already pinned
+    OperationId submit_read_fixed(IoFile file, unsigned buffer_index, void* buffer, size_t length,
+                                  CompletionCallback callback) {
+        io_uring_sqe* sqe = prepare(IORING_OP_READ_FIXED, file, std::move(callback));
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        sqe->len = static_cast<uint32_t>(length);
+        sqe->off = static_cast<uint64_t>(-1);
+        sqe->buf_index = static_cast<uint16_t>(buffer_index);
+        return sqe->user_data;
+    }
+
+    OperationId submit_write_fixed(IoFile file, unsigned buffer_index, const void* buffer, size_t length,
+                                   CompletionCallback callback) {
+        io_uring_sqe* sqe = prepare(IORING_OP_WRITE_FIXED, file, std::move(callback));
+        sqe->addr = reinterpret_cast<uint64_t>(buffer);
+        sqe->len = static_cast<uint32_t>(length);
+        sqe->off = static_cast<uint64_t>(-1);
+        sqe->buf_index = static_cast<uint16_t>(buffer_index);
+        return sqe->user_data;
+    }
+
+    // Multishot accept: one callback per connection with the new fd, until
+    // cancelled or an error ends the operation
+    OperationId submit_accept(IoFile listener, CompletionCallback callback) {
+        io_uring_sqe* sqe = prepare(IORING_OP_ACCEPT, listener, std::move(callback));
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        return sqe->user_data;
+    }
+
+    // Multishot receive into buffers of buffer_group (add_buffer_group()).
+    // data is only valid during the callback; its buffer is handed back to
+    // the kernel afterwards. A result of 0 is end of stream, and -ENOBUFS
+    // means the group ran dry; both end the operation.
+    OperationId submit_recv(IoFile file, uint16_t buffer_group, BufferCallback callback) {
+        io_uring_sqe* sqe = prepare(IORING_OP_RECV, file, nullptr);
+        Operation& operation = operations_[static_cast<uint32_t>(sqe->user_data)];
+        operation.buffer_callback = std::move(callback);
+        operation.buffer_group = buffer_group;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags |= IOSQE_BUFFER_SELECT;
+        sqe->buf_group = buffer_group;
+        return sqe->user_data;
+    }
+
+    // Requests cancellation; the callback still runs once more with the
+    // final result, normally -ECANCELED. False if the operation is done.
+    bool cancel_operation(OperationId id) {
+        auto index = static_cast<uint32_t>(id);
+        if (!uses_io_uring() || (id & OPERATION_TAG) == 0 || index >= operations_.size() ||
+            !operations_[index].in_use ||
+            operations_[index].generation != static_cast<uint32_t>((id >> 32) & GENERATION_MASK)) {
+            return false;
         }
-    };
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = id;
+        sqe->user_data = IGNORED_COMPLETION;
+        return true;
+    }
+
+    void register_buffers(std::span<const iovec> buffers) {
+        require_io_uring().register_buffers(buffers);
+    }
+
+    void register_files(std::span<const int> fds) {
+        require_io_uring().register_files(fds);
+    }
+
+    // Buffers for submit_recv(); queued to the kernel with the next submit
+    void add_buffer_group(uint16_t group, unsigned count, unsigned size) {
+        require_io_uring().add_buffer_group(group, count, size);
+        for (unsigned first = 0; first < count; first += UINT16_MAX) {
+            io_uring_sqe* sqe = next_sqe();
+            ring_->prepare_provide(sqe, group, static_cast<uint16_t>(first),
+                                   std::min<unsigned>(count - first, UINT16_MAX));
+            sqe->user_data = IGNORED_COMPLETION;
+        }
+    }
+#endif
 
+private:
     void process_events() {
 #ifdef _WIN32
         DWORD bytes_transferred;
@@ -116,101 +712,686 @@ private:
         LPOVERLAPPED overlapped;
         
         if (GetQueuedCompletionStatus(event_handle_, &bytes_transferred,
-                                    &completion_key, &overlapped, 100)) {
-            auto callback = (EventCallback*)completion_key;
-            (*callback)();
+                                    &completion_key, &overlapped, wait_timeout_ms())) {
+            Channel* channel = channels_.find((FileDescriptor)completion_key);
+            if (channel && channel->registered) {
+                dispatch(*channel, EVENT_READ);
+            }
         }
 #else
+#ifdef ASYNC_TOOLKIT_HAS_IO_URING
+        if (uses_io_uring()) {
+            process_completions();
+            return;
+        }
+#endif
         epoll_event events[64];
         int nfds = epoll_wait(epoll_fd_, events, 64, 100);
         
         for (int i = 0; i < nfds; ++i) {
-            auto callback = (EventCallback*)events[i].data.ptr;
-            (*callback)();
+            auto fd = static_cast<FileDescriptor>(events[i].data.u64 & 0xffffffffu);
+            auto generation = static_cast<uint32_t>(events[i].data.u64 >> 32);
+            Channel* channel = channels_.find(fd);
+            if (!channel || !channel->registered || channel->generation != generation) {
+                continue;
+            }
+            dispatch(*channel, to_mask(events[i].events));
+        }
+#endif
+    }
+
+    void dispatch(Channel& channel, uint32_t events) {
+        channel.dispatching = true;
+        try {
+            channel.callback(events);
+        } catch (...) {
+            finish_dispatch(channel);
+            throw;
+        }
+        finish_dispatch(channel);
+    }
+
+    // Applies unregister/re-register requests made while the callback ran
+    static void finish_dispatch(Channel& channel) {
+        channel.dispatching = false;
+        if (channel.replace) {
+            channel.callback = std::move(channel.replacement);
+            channel.replacement = nullptr;
+            channel.replace = false;
+        } else if (!channel.registered) {
+            channel.callback = nullptr;
+        }
+    }
+
+#ifndef _WIN32
+    static epoll_event make_event(FileDescriptor fd, uint32_t interest, uint32_t generation) {
+        epoll_event event{};
+        event.events = EPOLLET | EPOLLRDHUP;
+        if (interest & EVENT_READ) {
+            event.events |= EPOLLIN;
+        }
+        if (interest & EVENT_WRITE) {
+            event.events |= EPOLLOUT;
+        }
+        event.data.u64 = (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+        return event;
+    }
+
+    static uint32_t to_mask(uint32_t epoll_events) {
+        uint32_t mask = EVENT_NONE;
+        if (epoll_events & (EPOLLIN | EPOLLPRI)) {
+            mask |= EVENT_READ;
+        }
+        if (epoll_events & EPOLLOUT) {
+            mask |= EVENT_WRITE;
+        }
+        if (epoll_events & EPOLLERR) {
+            mask |= EVENT_ERROR;
+        }
+        if (epoll_events & (EPOLLHUP | EPOLLRDHUP)) {
+            mask |= EVENT_HANGUP;
+        }
+        return mask;
+    }
+#endif
+
+    void wakeup() {
+#ifdef _WIN32
+        // The key matches no channel, so the completion only ends the wait
+        PostQueuedCompletionStatus(event_handle_, 0, static_cast<ULONG_PTR>(INVALID_SOCKET), nullptr);
+#else
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(wakeup_fd_, &one, sizeof(one));
+#endif
+    }
+
+    // Swaps the queue out so functors can queue more without deadlocking
+    void run_pending_functors() {
+        {
+            std::lock_guard<std::mutex> lock(functor_mutex_);
+            if (pending_functors_.empty()) {
+                return;
+            }
+            running_functors_.swap(pending_functors_);
+        }
+        calling_functors_ = true;
+        struct Reset {
+            EventLoop* loop;
+            ~Reset() {
+                loop->running_functors_.clear();
+                loop->calling_functors_ = false;
+            }
+        } reset{this};
+        for (auto& functor : running_functors_) {
+            functor();
+        }
+    }
+
+    bool uses_io_uring() const {
+#ifdef ASYNC_TOOLKIT_HAS_IO_URING
+        return ring_ != nullptr;
+#else
+        return false;
+#endif
+    }
+
+#ifdef ASYNC_TOOLKIT_HAS_IO_URING
+    // user_data layout: poll requests carry (generation << 32) | fd like the
+    // epoll events; operations set the top bit over their slot and slot
+    // generation; control requests whose completions carry nothing use
+    // IGNORED_COMPLETION
+    static constexpr uint64_t OPERATION_TAG = 1ull << 63;
+    static constexpr uint64_t GENERATION_MASK = 0x7fffffff;
+    static constexpr uint64_t IGNORED_COMPLETION = UINT64_MAX;
+    static constexpr uint32_t NO_OPERATION = UINT32_MAX;
+
+    struct Operation {
+        CompletionCallback callback;
+        BufferCallback buffer_callback;
+        uint32_t generation = 0;
+        uint32_t next_free = NO_OPERATION;
+        uint16_t buffer_group = 0;
+        bool in_use = false;
+    };
+
+    IoUring& require_io_uring() {
+        if (!ring_) {
+            throw std::logic_error("Operation requires the io_uring backend");
+        }
+        return *ring_;
+    }
+
+    // Flushes queued SQEs early when the submission ring is full
+    io_uring_sqe* next_sqe() {
+        io_uring_sqe* sqe = ring_->get_sqe();
+        if (!sqe) {
+            ring_->submit();
+            sqe = ring_->get_sqe();
+            if (!sqe) {
+                throw std::runtime_error("io_uring submission queue is full");
+            }
+        }
+        return sqe;
+    }
+
+    static uint64_t poll_data(FileDescriptor fd, uint32_t generation) {
+        return ((generation & GENERATION_MASK) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    void arm_poll(FileDescriptor fd, uint32_t interest, uint32_t generation) {
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = make_event(fd, interest, generation).events & ~static_cast<uint32_t>(EPOLLET);
+        sqe->user_data = poll_data(fd, generation);
+    }
+
+    void cancel_poll(FileDescriptor fd, uint32_t generation) {
+        io_uring_sqe* sqe = next_sqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->addr = poll_data(fd, generation);
+        sqe->user_data = IGNORED_COMPLETION;
+    }
+
+    io_uring_sqe* prepare(uint8_t opcode, IoFile file, CompletionCallback callback) {
+        require_io_uring();
+        io_uring_sqe* sqe = next_sqe();
+        uint32_t index;
+        if (free_operation_ != NO_OPERATION) {
+            index = free_operation_;
+            free_operation_ = operations_[index].next_free;
+        } else {
+            index = static_cast<uint32_t>(operations_.size());
+            operations_.emplace_back();
+        }
+        Operation& operation = operations_[index];
+        operation.callback = std::move(callback);
+        operation.in_use = true;
+        sqe->opcode = opcode;
+        sqe->fd = file.fd;
+        if (file.is_fixed) {
+            sqe->flags |= IOSQE_FIXED_FILE;
+        }
+        sqe->user_data = OPERATION_TAG | ((operation.generation & GENERATION_MASK) << 32) | index;
+        return sqe;
+    }
+
+    void release_operation(uint32_t index) {
+        Operation& operation = operations_[index];
+        operation.callback = nullptr;
+        operation.buffer_callback = nullptr;
+        operation.in_use = false;
+        operation.generation = (operation.generation + 1) & GENERATION_MASK;
+        operation.next_free = free_operation_;
+        free_operation_ = index;
+    }
+
+    // One io_uring_enter per iteration submits everything queued since the
+    // last one and waits for completions
+    void process_completions() {
+        timespec timeout{0, 100 * 1000 * 1000};
+        int ret = ring_->submit(1, &timeout);
+        if (ret < 0 && ret != -ETIME && ret != -EINTR && ret != -EBUSY) {
+            throw std::runtime_error(std::string("io_uring_enter failed: ") + std::strerror(-ret));
+        }
+        ring_->for_each_completion([this](const io_uring_cqe& cqe) {
+            if (cqe.user_data == IGNORED_COMPLETION) {
+                return;
+            }
+            if (cqe.user_data & OPERATION_TAG) {
+                complete_operation(cqe);
+            } else {
+                complete_poll(cqe);
+            }
+        });
+    }
+
+    void complete_poll(const io_uring_cqe& cqe) {
+        auto fd = static_cast<FileDescriptor>(cqe.user_data & 0xffffffffu);
+        auto generation = static_cast<uint32_t>(cqe.user_data >> 32);
+        Channel* channel = channels_.find(fd);
+        if (!channel || !channel->registered || (channel->generation & GENERATION_MASK) != generation) {
+            return;
+        }
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+        if (cqe.res < 0) {
+            // The request is gone; a dead fd is reported, a transient
+            // failure is retried
+            if (cqe.res == -EBADF) {
+                dispatch(*channel, EVENT_ERROR);
+            } else if (!more) {
+                arm_poll(fd, channel->interest, channel->generation);
+            }
+            return;
+        }
+        uint32_t current = channel->generation;
+        dispatch(*channel, to_mask(static_cast<uint32_t>(cqe.res)));
+        // The kernel ends multishot polls on its own, e.g. when the CQ ring
+        // overflows; re-arm unless the callback already replaced the request
+        if (!more && channel->registered && channel->generation == current) {
+            arm_poll(fd, channel->interest, channel->generation);
+        }
+    }
+
+    void complete_operation(const io_uring_cqe& cqe) {
+        auto index = static_cast<uint32_t>(cqe.user_data);
+        auto generation = static_cast<uint32_t>((cqe.user_data >> 32) & GENERATION_MASK);
+        if (index >= operations_.size() || !operations_[index].in_use ||
+            operations_[index].generation != generation) {
+            return;
+        }
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+        Operation& operation = operations_[index];
+        CompletionCallback callback;
+        BufferCallback buffer_callback;
+        uint16_t group = operation.buffer_group;
+        if (more) {
+            callback = operation.callback;
+            buffer_callback = operation.buffer_callback;
+        } else {
+            // Freed before the callback runs so it can reuse the slot
+            callback = std::move(operation.callback);
+            buffer_callback = std::move(operation.buffer_callback);
+            release_operation(index);
+        }
+
+        if (!buffer_callback) {
+            callback(cqe.res);
+            return;
+        }
+        if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+            buffer_callback(cqe.res, {});
+            return;
+        }
+        auto buffer_id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        try {
+            buffer_callback(cqe.res, ring_->buffer(group, buffer_id, cqe.res > 0 ? cqe.res : 0));
+        } catch (...) {
+            recycle_buffer(group, buffer_id);
+            throw;
         }
+        recycle_buffer(group, buffer_id);
+    }
+
+    void recycle_buffer(uint16_t group, uint16_t id) {
+        io_uring_sqe* sqe = next_sqe();
+        ring_->prepare_provide(sqe, group, id, 1);
+        sqe->user_data = IGNORED_COMPLETION;
+    }
+#elif !defined(_WIN32)
+    // Unreachable: uses_io_uring() is always false without io_uring
+    void arm_poll(FileDescriptor, uint32_t, uint32_t) {}
+    void cancel_poll(FileDescriptor, uint32_t) {}
 #endif
+
+    uint64_t current_tick() const {
+        auto elapsed = std::chrono::steady_clock::now() - start_time_;
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
     }
 
     void process_timers() {
         std::unique_lock<std::mutex> lock(timer_mutex_);
-        auto now = std::chrono::steady_clock::now();
-
-        while (!timers_.empty() && timers_.top().deadline <= now) {
-            auto timer = timers_.top();
-            timers_.pop();
+        uint64_t now = current_tick();
+        due_.clear();
+        wheel_.expire(now, due_);
 
+        // Callbacks run unlocked so they can add or cancel timers; due_ is
+        // only touched by the loop thread
+        for (size_t i = 0; i < due_.size(); ++i) {
+            uint32_t index = due_[i];
+            TimerCallback& callback = wheel_.callback(index);
             lock.unlock();
-            timer.callback();
+            try {
+                callback();
+            } catch (...) {
+                lock.lock();
+                rearm_remaining_locked(i, now);
+                throw;
+            }
             lock.lock();
+            wheel_.rearm(index, now);
+        }
+        arm_timer_locked();
+    }
+
+    void rearm_remaining_locked(size_t failed, uint64_t now) {
+        for (size_t i = failed; i < due_.size(); ++i) {
+            wheel_.rearm(due_[i], now);
+        }
+        arm_timer_locked();
+    }
+
+    // Points the timerfd at the start of the wheel's next due tick. Adding a
+    // timer only re-arms when it is due earlier; cancelling never does, and
+    // the resulting early wakeup finds nothing to run.
+    void arm_timer_locked() {
+        arm_at_locked(wheel_.next_expiry().value_or(UINT64_MAX));
+    }
 
-            if (timer.periodic) {
-                timer.deadline += timer.period;
-                timers_.push(timer);
+    void arm_at_locked(uint64_t tick) {
+        armed_tick_ = tick;
+#ifndef _WIN32
+        itimerspec spec{};
+        if (tick != UINT64_MAX) {
+            auto deadline = start_time_ + std::chrono::milliseconds(tick);
+            auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                deadline.time_since_epoch()).count();
+            spec.it_value.tv_sec = since_epoch / 1000000000;
+            spec.it_value.tv_nsec = since_epoch % 1000000000;
+            if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+                spec.it_value.tv_nsec = 1;
             }
         }
+        timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+#endif
+    }
+
+#ifdef _WIN32
+    DWORD wait_timeout_ms() {
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+        auto next = wheel_.next_expiry();
+        if (!next) {
+            return 100;
+        }
+        uint64_t now = current_tick();
+        return static_cast<DWORD>(*next > now ? std::min<uint64_t>(*next - now, 100) : 0);
     }
+#endif
 
 #ifdef _WIN32
     HANDLE event_handle_;
 #else
-    int epoll_fd_;
+    int epoll_fd_ = -1;
+    int timer_fd_ = -1;
+    int wakeup_fd_ = -1;
+#endif
+#ifdef ASYNC_TOOLKIT_HAS_IO_URING
+    std::unique_ptr<IoUring> ring_;
+    std::deque<Operation> operations_;
+    uint32_t free_operation_ = NO_OPERATION;
 #endif
     std::atomic<bool> running_;
-    std::unordered_map<FileDescriptor, EventCallback> handlers_;
-    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    std::atomic<std::thread::id> thread_id_{};
+    std::atomic<size_t> handler_count_{0};
+    std::mutex functor_mutex_;
+    std::vector<Functor> pending_functors_;
+    std::vector<Functor> running_functors_;
+    bool calling_functors_ = false;
+    ChannelTable channels_;
+    const std::chrono::steady_clock::time_point start_time_;
+    TimerWheel wheel_;
+    uint64_t armed_tick_ = UINT64_MAX;
+    std::vector<uint32_t> due_;
     std::mutex timer_mutex_;
-    std::condition_variable timer_cv_;
 };
 
-// 便捷的TCP服务器包装
+// Accept counters of a TcpServer. Take two snapshots and call rate() for
+// connections per second over the interval.
+struct AcceptStats {
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;     // Accepted and closed at once: fd limit reached
+    uint64_t errors = 0;       // Failed accept calls other than EAGAIN
+    uint64_t batches = 0;      // Readiness notifications that accepted something
+    uint64_t max_batch = 0;    // Most connections drained by one notification
+    std::chrono::steady_clock::time_point taken;
+
+    static double rate(const AcceptStats& earlier, const AcceptStats& later) {
+        double seconds = std::chrono::duration<double>(later.taken - earlier.taken).count();
+        return seconds > 0 ? static_cast<double>(later.accepted - earlier.accepted) / seconds : 0.0;
+    }
+};
+
+// 便捷的TCP服务器包装. Listens on an IPv4, IPv6 or Unix socket address and
+// hands each accepted, non-blocking fd to the connection callback.
 class TcpServer {
 public:
-    TcpServer(EventLoop& loop, uint16_t port)
-        : loop_(loop) {
+    using ConnectionCallback = std::function<void(FileDescriptor fd, const SocketAddress& peer)>;
+
+    // reuse_port lets several servers, one per loop, listen on the same port;
+    // the kernel then spreads incoming connections across them
+    TcpServer(EventLoop& loop, uint16_t port, bool reuse_port = false)
+        : TcpServer(loop, SocketAddress::any_ipv4(port), reuse_port) {}
+
+    TcpServer(EventLoop& loop, const SocketAddress& address, bool reuse_port = false)
+        : loop_(loop), address_(address) {
         // 初始化服务器socket
 #ifdef _WIN32
-        server_socket_ = WSASocket(AF_INET, SOCK_STREAM, 0, NULL, 0, 
+        server_socket_ = WSASocket(address.family(), SOCK_STREAM, 0, NULL, 0,
                                  WSA_FLAG_OVERLAPPED);
 #else
-        server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
+        server_socket_ = socket(address.family(), SOCK_STREAM, 0);
+        if (server_socket_ < 0) {
+            throw std::runtime_error(std::string("socket failed: ") + std::strerror(errno));
+        }
         fcntl(server_socket_, F_SETFL, O_NONBLOCK);
+        fcntl(server_socket_, F_SETFD, FD_CLOEXEC);
+#endif
+
+        int enable = 1;
+        if (!address.is_unix()) {
+            setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, (const char*)&enable, sizeof(enable));
+        }
+#ifndef _WIN32
+        if (address.is_unix()) {
+            remove_stale_socket(address);
+        }
 #endif
+        if (reuse_port) {
+#ifdef SO_REUSEPORT
+            setsockopt(server_socket_, SOL_SOCKET, SO_REUSEPORT, (const char*)&enable, sizeof(enable));
+#else
+            close_socket(server_socket_);
+            throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+        }
 
-        sockaddr_in addr;
-        addr.sin_family = AF_INET;
-        addr.sin_addr.s_addr = INADDR_ANY;
-        addr.sin_port = htons(port);
-        bind(server_socket_, (sockaddr*)&addr, sizeof(addr));
-        listen(server_socket_, SOMAXCONN);
+        if (bind(server_socket_, address.data(), address.size()) != 0 ||
+            listen(server_socket_, SOMAXCONN) != 0) {
+            std::string error = std::strerror(errno);
+            close_socket(server_socket_);
+            throw std::runtime_error("Failed to listen on " + address.to_string() + ": " + error);
+        }
+        // Port 0 picks a free port; report the real one
+        sockaddr_storage bound;
+        socklen_t bound_length = sizeof(bound);
+        if (getsockname(server_socket_, (sockaddr*)&bound, &bound_length) == 0) {
+            address_ = SocketAddress::from((sockaddr*)&bound, bound_length);
+        }
+
+#ifndef _WIN32
+        // Spare descriptor released to accept-and-close a connection when the
+        // process is out of fds; otherwise the pending connection stays in the
+        // backlog and, being edge-triggered, is never reported again
+        reserve_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+#endif
 
         // 注册接受连接的处理器
-        loop_.register_handler(server_socket_, [this] { accept_connection(); });
+        loop_.register_handler(server_socket_, [this](uint32_t) { accept_connection(); });
     }
 
+    ~TcpServer() {
+        loop_.cancel_timer(retry_timer_);
+        loop_.unregister_handler(server_socket_);
+        close_socket(server_socket_);
+#ifndef _WIN32
+        if (reserve_fd_ >= 0) {
+            close(reserve_fd_);
+        }
+        if (address_.is_unix()) {
+            unlink(address_.to_string().c_str());
+        }
+#endif
+    }
+
+    TcpServer(const TcpServer&) = delete;
+    TcpServer& operator=(const TcpServer&) = delete;
+
     void set_connection_callback(std::function<void(FileDescriptor)> callback) {
+        on_connection_ = [callback = std::move(callback)](FileDescriptor fd, const SocketAddress&) {
+            callback(fd);
+        };
+    }
+
+    void set_connection_callback(ConnectionCallback callback) {
         on_connection_ = std::move(callback);
     }
 
+    // Bound address, with the actual port when constructed with port 0
+    const SocketAddress& address() const { return address_; }
+
+    // Safe to call from any thread
+    AcceptStats stats() const {
+        return AcceptStats{
+            .accepted = accepted_.load(std::memory_order_relaxed),
+            .rejected = rejected_.load(std::memory_order_relaxed),
+            .errors = errors_.load(std::memory_order_relaxed),
+            .batches = batches_.load(std::memory_order_relaxed),
+            .max_batch = max_batch_.load(std::memory_order_relaxed),
+            .taken = std::chrono::steady_clock::now()};
+    }
+
 private:
+    static constexpr std::chrono::milliseconds RETRY_DELAY{10};
+
+    static void close_socket(FileDescriptor fd) {
+#ifdef _WIN32
+        closesocket(fd);
+#else
+        close(fd);
+#endif
+    }
+
+#ifndef _WIN32
+    // A socket file left behind by a server that died makes bind() fail
+    // with EADDRINUSE. Only a socket nobody is listening on is removed;
+    // regular files and live servers are left for bind() to report.
+    static void remove_stale_socket(const SocketAddress& address) {
+        std::string path = address.to_string();
+        struct stat info;
+        if (lstat(path.c_str(), &info) != 0 || !S_ISSOCK(info.st_mode)) {
+            return;
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (probe < 0) {
+            return;
+        }
+        bool refused = connect(probe, address.data(), address.size()) != 0 && errno == ECONNREFUSED;
+        close(probe);
+        if (refused) {
+            unlink(path.c_str());
+        }
+    }
+#endif
+
+    // Edge-triggered: keep accepting until the backlog is empty
     void accept_connection() {
-        sockaddr_in client_addr;
-        socklen_t addr_len = sizeof(client_addr);
+        uint64_t batch = 0;
+        while (true) {
+            sockaddr_storage client_addr;
+            socklen_t addr_len = sizeof(client_addr);
 #ifdef _WIN32
-        auto client_socket = WSAAccept(server_socket_, (sockaddr*)&client_addr,
-                                     &addr_len, NULL, 0);
+            auto client_socket = WSAAccept(server_socket_, (sockaddr*)&client_addr,
+                                         &addr_len, NULL, 0);
+            if (client_socket == INVALID_SOCKET) {
+                break;
+            }
 #else
-        auto client_socket = accept(server_socket_, (sockaddr*)&client_addr,
-                                  &addr_len);
+#ifdef __linux__
+            auto client_socket = accept4(server_socket_, (sockaddr*)&client_addr,
+                                         &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+            auto client_socket = accept(server_socket_, (sockaddr*)&client_addr,
+                                      &addr_len);
+            if (client_socket >= 0) {
+                fcntl(client_socket, F_SETFL, fcntl(client_socket, F_GETFL, 0) | O_NONBLOCK);
+            }
+#endif
+            if (client_socket < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) {
+                    continue;
+                }
+                if ((errno == EMFILE || errno == ENFILE) && reserve_fd_ >= 0) {
+                    // Linux reports EMFILE before looking at the backlog, so
+                    // this also ends a drain that has nothing left to accept
+                    if (reject_pending()) {
+                        continue;
+                    }
+                    break;
+                }
+                // ENOBUFS, ENOMEM or no spare fd: no new edge will come for
+                // the connections still queued, so poll again shortly
+                errors_.fetch_add(1, std::memory_order_relaxed);
+                schedule_retry();
+                break;
+            }
 #endif
 
-        if (on_connection_) {
-            on_connection_(client_socket);
+            ++batch;
+            accepted_.fetch_add(1, std::memory_order_relaxed);
+            if (on_connection_) {
+                on_connection_(client_socket, SocketAddress::from((sockaddr*)&client_addr, addr_len));
+            } else {
+                close_socket(client_socket);
+            }
+        }
+        if (batch > 0) {
+            batches_.fetch_add(1, std::memory_order_relaxed);
+            if (batch > max_batch_.load(std::memory_order_relaxed)) {
+                max_batch_.store(batch, std::memory_order_relaxed);
+            }
         }
     }
 
+#ifndef _WIN32
+    // Frees the spare fd, accepts the oldest pending connection and closes
+    // it, so the client sees a reset instead of hanging in the backlog.
+    // Returns false once the backlog is empty.
+    bool reject_pending() {
+        close(reserve_fd_);
+        int client = accept(server_socket_, nullptr, nullptr);
+        int error = errno;
+        if (client >= 0) {
+            close(client);
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+        }
+        reserve_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (client < 0 && error != EAGAIN && error != EWOULDBLOCK) {
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            schedule_retry();
+        }
+        return client >= 0;
+    }
+#endif
+
+    void schedule_retry() {
+        if (retry_timer_ != INVALID_TIMER) {
+            return;
+        }
+        // Timer callbacks run on the loop thread, like the accept handler
+        retry_timer_ = loop_.run_after(RETRY_DELAY, [this] {
+            retry_timer_ = INVALID_TIMER;
+            accept_connection();
+        });
+    }
+
     EventLoop& loop_;
+    SocketAddress address_;
     FileDescriptor server_socket_;
-    std::function<void(FileDescriptor)> on_connection_;
+#ifndef _WIN32
+    int reserve_fd_ = -1;
+#endif
+    ConnectionCallback on_connection_;
+    TimerId retry_timer_ = INVALID_TIMER;
+    std::atomic<uint64_t> accepted_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> max_batch_{0};
 };
 
 } // namespace async_toolkit::reactor
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "event_loop.hpp"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace async_toolkit::reactor {
+
+// One EventLoop per thread. With pin_threads, loop i runs on CPU
+// i % hardware_concurrency, so each loop's channels, buffers and timer
+// wheel stay in one core's caches. Loops are created up front: handlers may
+// be registered on them directly until start(), and through run_in_loop
+// afterwards.
+class EventLoopGroup {
+public:
+    explicit EventLoopGroup(size_t loops = std::thread::hardware_concurrency(),
+                            bool pin_threads = true, Backend backend = Backend::EPOLL)
+        : pin_threads_(pin_threads) {
+        loops = std::max<size_t>(loops, 1);
+        loops_.reserve(loops);
+        for (size_t i = 0; i < loops; ++i) {
+            loops_.push_back(std::make_unique<EventLoop>(backend));
+        }
+    }
+
+    ~EventLoopGroup() {
+        stop();
+    }
+
+    EventLoopGroup(const EventLoopGroup&) = delete;
+    EventLoopGroup& operator=(const EventLoopGroup&) = delete;
+
+    void start() {
+        if (!threads_.empty()) {
+            throw std::logic_error("EventLoopGroup is already running");
+        }
+        threads_.reserve(loops_.size());
+        for (size_t i = 0; i < loops_.size(); ++i) {
+            threads_.emplace_back([this, i] {
+                if (pin_threads_) {
+                    pin_current_thread(i);
+                }
+                loops_[i]->run();
+            });
+        }
+    }
+
+    // Stops every loop and joins its thread. The stop request is queued
+    // rather than set directly so a thread that has not reached run() yet
+    // cannot miss it.
+    void stop() {
+        if (threads_.empty()) {
+            return;
+        }
+        for (auto& loop : loops_) {
+            EventLoop* target = loop.get();
+            target->queue_in_loop([target] { target->stop(); });
+        }
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+        threads_.clear();
+    }
+
+    size_t size() const { return loops_.size(); }
+
+    EventLoop& loop(size_t index) {
+        return *loops_.at(index);
+    }
+
+    EventLoop& next_loop() {
+        return *loops_[next_.fetch_add(1, std::memory_order_relaxed) % loops_.size()];
+    }
+
+    // Loop with the fewest registered handlers. The scan starts at a
+    // rotating offset so ties, common while new connections are still being
+    // handed over, are spread round-robin.
+    EventLoop& least_loaded_loop() {
+        size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+        EventLoop* best = nullptr;
+        size_t best_count = SIZE_MAX;
+        for (size_t i = 0; i < loops_.size(); ++i) {
+            EventLoop* candidate = loops_[(start + i) % loops_.size()].get();
+            size_t count = candidate->handler_count();
+            if (count < best_count) {
+                best = candidate;
+                best_count = count;
+            }
+        }
+        return *best;
+    }
+
+private:
+    static void pin_current_thread(size_t index) {
+        size_t cpus = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+#ifdef _WIN32
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (index % cpus % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(index % cpus, &set);
+        // Best effort: a restricted cpuset makes this fail, and the loop
+        // still runs unpinned
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+        (void)index;
+        (void)cpus;
+#endif
+    }
+
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_{0};
+    bool pin_threads_;
+};
+
+// How a ShardedTcpServer spreads connections over its group
+enum class AcceptMode {
+    REUSE_PORT,     // One SO_REUSEPORT listener per loop, balanced by the kernel
+    ROUND_ROBIN,    // Loop 0 accepts and hands fds out in turn
+    LEAST_LOADED    // Loop 0 accepts and picks the loop with the fewest handlers
+};
+
+// TcpServer spread over an EventLoopGroup. The connection callback runs on
+// the loop that owns the new connection, which is where its handler must be
+// registered. Construct the server before EventLoopGroup::start() and
+// destroy it after stop().
+class ShardedTcpServer {
+public:
+    using ConnectionCallback = std::function<void(FileDescriptor fd, EventLoop& loop)>;
+
+    ShardedTcpServer(EventLoopGroup& group, uint16_t port, AcceptMode mode = AcceptMode::REUSE_PORT)
+        : group_(group), mode_(mode) {
+        if (mode == AcceptMode::REUSE_PORT) {
+            if (port == 0) {
+                throw std::invalid_argument("SO_REUSEPORT sharding needs a fixed port");
+            }
+            for (size_t i = 0; i < group.size(); ++i) {
+                EventLoop& loop = group.loop(i);
+                auto server = std::make_unique<TcpServer>(loop, port, true);
+                server->set_connection_callback([this, &loop](FileDescriptor fd) {
+                    deliver(fd, loop);
+                });
+                listeners_.push_back(std::move(server));
+            }
+        } else {
+            auto server = std::make_unique<TcpServer>(group.loop(0), port);
+            server->set_connection_callback([this](FileDescriptor fd) {
+                EventLoop& target = mode_ == AcceptMode::LEAST_LOADED
+                    ? group_.least_loaded_loop() : group_.next_loop();
+                target.run_in_loop([this, fd, &target] { deliver(fd, target); });
+            });
+            listeners_.push_back(std::move(server));
+        }
+    }
+
+    ShardedTcpServer(const ShardedTcpServer&) = delete;
+    ShardedTcpServer& operator=(const ShardedTcpServer&) = delete;
+
+    void set_connection_callback(ConnectionCallback callback) {
+        on_connection_ = std::move(callback);
+    }
+
+    // Connections handed to the callback so far, across all loops
+    size_t connections() const {
+        return connections_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void deliver(FileDescriptor fd, EventLoop& loop) {
+        connections_.fetch_add(1, std::memory_order_relaxed);
+        if (on_connection_) {
+            on_connection_(fd, loop);
+        } else {
+#ifdef _WIN32
+            closesocket(fd);
+#else
+            close(fd);
+#endif
+        }
+    }
+
+    EventLoopGroup& group_;
+    AcceptMode mode_;
+    std::vector<std::unique_ptr<TcpServer>> listeners_;
+    ConnectionCallback on_connection_;
+    std::atomic<size_t> connections_{0};
+};
+
+} // namespace async_toolkit::reactor
@@ -0,0 +1,249 @@
+#pragma once
+
+// io_uring is used through its raw syscalls, so only the kernel UAPI header
+// is needed; without it EventLoop offers the epoll backend alone
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ASYNC_TOOLKIT_HAS_IO_URING 1
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace async_toolkit::reactor {
+
+// Submission and completion rings of one io_uring instance. A single thread
+// fills SQEs and reaps CQEs; the ring indices shared with the kernel are
+// published with release stores and read with acquire loads.
+class IoUring {
+public:
+    explicit IoUring(unsigned entries = 256) {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CLAMP;
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) {
+            throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+        }
+        // EXT_ARG (5.11) gives io_uring_enter a timeout without a timeout SQE
+        constexpr unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+        if ((params.features & required) != required) {
+            close(fd_);
+            throw std::runtime_error("io_uring kernel support is too old");
+        }
+
+        ring_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+                              params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        ring_ = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd_, IORING_OFF_SQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          fd_, IORING_OFF_SQES);
+        if (ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+            int error = errno;
+            if (ring_ != MAP_FAILED) {
+                munmap(ring_, ring_size_);
+            }
+            close(fd_);
+            throw std::runtime_error(std::string("io_uring mmap failed: ") + std::strerror(error));
+        }
+
+        auto* base = static_cast<char*>(ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+        sq_ktail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        cq_khead_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        cq_ktail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        // SQEs are always consumed in order, so the indirection array is
+        // the identity mapping, written once
+        auto* array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries_; ++i) {
+            array[i] = i;
+        }
+        sq_tail_ = sq_flushed_ = *sq_ktail_;
+    }
+
+    ~IoUring() {
+        munmap(sqes_, sqes_size_);
+        munmap(ring_, ring_size_);
+        close(fd_);
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Zeroed SQE, or nullptr when every slot is queued but not yet submitted
+    io_uring_sqe* get_sqe() {
+        unsigned head = std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+        if (sq_tail_ - head >= sq_entries_) {
+            return nullptr;
+        }
+        io_uring_sqe* sqe = &sqes_[sq_tail_ & sq_mask_];
+        ++sq_tail_;
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    // Hands every queued SQE to the kernel in one io_uring_enter. With
+    // wait_nr > 0 it also blocks for that many completions or until timeout
+    // (nullptr waits indefinitely). Returns the submit count or -errno.
+    // SQEs the kernel did not consume, e.g. on -EBUSY, stay pending and go
+    // out with the next call.
+    int submit(unsigned wait_nr = 0, const timespec* timeout = nullptr) {
+        unsigned to_submit = sq_tail_ - sq_flushed_;
+        std::atomic_ref<unsigned>(*sq_ktail_).store(sq_tail_, std::memory_order_release);
+        if (to_submit == 0 && wait_nr == 0) {
+            return 0;
+        }
+
+        unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+        io_uring_getevents_arg arg{};
+        if (timeout) {
+            arg.ts = reinterpret_cast<uint64_t>(timeout);
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+        long ret = syscall(__NR_io_uring_enter, fd_, to_submit, wait_nr, flags,
+                           timeout ? &arg : nullptr, sizeof(arg));
+        if (ret < 0) {
+            return -errno;
+        }
+        sq_flushed_ += std::min(static_cast<unsigned>(ret), to_submit);
+        return static_cast<int>(ret);
+    }
+
+    bool has_pending_submissions() const { return sq_tail_ != sq_flushed_; }
+
+    // Invokes f on every available CQE; CQ slots are handed back to the
+    // kernel once the whole batch is processed
+    template<typename F>
+    unsigned for_each_completion(F&& f) {
+        unsigned head = *cq_khead_;
+        unsigned tail = std::atomic_ref<unsigned>(*cq_ktail_).load(std::memory_order_acquire);
+        unsigned count = tail - head;
+        struct Release {
+            unsigned* khead;
+            unsigned& head;
+            ~Release() { std::atomic_ref<unsigned>(*khead).store(head, std::memory_order_release); }
+        } release{cq_khead_, head};
+        for (; head != tail; ++head) {
+            f(cqes_[head & cq_mask_]);
+        }
+        return count;
+    }
+
+    void register_buffers(std::span<const iovec> buffers) {
+        do_register(IORING_REGISTER_BUFFERS, buffers.data(), buffers.size(), "buffers");
+    }
+
+    void register_files(std::span<const int> fds) {
+        do_register(IORING_REGISTER_FILES, fds.data(), fds.size(), "files");
+    }
+
+    // Allocates count buffers of size bytes for group. The kernel learns
+    // about them through prepare_provide() SQEs (IORING_OP_PROVIDE_BUFFERS,
+    // 5.7) and picks one for each completion of an IOSQE_BUFFER_SELECT
+    // operation.
+    void add_buffer_group(uint16_t group, unsigned count, unsigned size) {
+        if (count == 0 || count > 65536 || size == 0) {
+            throw std::invalid_argument("Buffer group needs 1 to 65536 non-empty buffers");
+        }
+        if (find_group(group)) {
+            throw std::runtime_error("Buffer group already registered");
+        }
+        BufferGroup entry;
+        entry.id = group;
+        entry.size = size;
+        entry.count = count;
+        entry.memory = std::make_unique<char[]>(static_cast<size_t>(count) * size);
+        groups_.push_back(std::move(entry));
+    }
+
+    // Fills sqe to hand buffers [first, first + count) of group to the kernel
+    void prepare_provide(io_uring_sqe* sqe, uint16_t group, uint16_t first, unsigned count) {
+        BufferGroup& entry = require_group(group);
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = static_cast<int>(count);
+        sqe->addr = reinterpret_cast<uint64_t>(entry.memory.get() + static_cast<size_t>(first) * entry.size);
+        sqe->len = entry.size;
+        sqe->buf_group = group;
+        sqe->off = first;
+    }
+
+    // Data the kernel placed in a selected buffer
+    std::span<const char> buffer(uint16_t group, uint16_t id, size_t length) {
+        BufferGroup& entry = require_group(group);
+        return {entry.memory.get() + static_cast<size_t>(id) * entry.size, length};
+    }
+
+private:
+    struct BufferGroup {
+        uint16_t id = 0;
+        unsigned size = 0;
+        unsigned count = 0;
+        std::unique_ptr<char[]> memory;
+    };
+
+    BufferGroup* find_group(uint16_t group) {
+        for (auto& entry : groups_) {
+            if (entry.id == group) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    BufferGroup& require_group(uint16_t group) {
+        BufferGroup* entry = find_group(group);
+        if (!entry) {
+            throw std::invalid_argument("Unknown buffer group");
+        }
+        return *entry;
+    }
+
+    void do_register(unsigned opcode, const void* data, size_t count, const char* what) {
+        if (syscall(__NR_io_uring_register, fd_, opcode, data, static_cast<unsigned>(count)) < 0) {
+            throw std::runtime_error(std::string("io_uring registration of ") + what +
+                                     " failed: " + std::strerror(errno));
+        }
+    }
+
+    int fd_ = -1;
+    void* ring_ = nullptr;
+    size_t ring_size_ = 0;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_ktail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sq_tail_ = 0;      // Local tail, published by submit()
+    unsigned sq_flushed_ = 0;   // Tail the kernel has consumed up to
+    io_uring_sqe* sqes_ = nullptr;
+
+    unsigned* cq_khead_ = nullptr;
+    unsigned* cq_ktail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    std::vector<BufferGroup> groups_;
+};
+
+} // namespace async_toolkit::reactor
+
+#endif
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+namespace async_toolkit::reactor {
+
+// IPv4, IPv6 or Unix domain socket address, stored by value in a
+// sockaddr_storage so it can be passed straight to bind/connect/accept
+class SocketAddress {
+public:
+    SocketAddress() {
+        std::memset(&storage_, 0, sizeof(storage_));
+    }
+
+    // Numeric address only; "0.0.0.0" or "::" binds every interface
+    static SocketAddress ipv4(const std::string& host, uint16_t port) {
+        SocketAddress address;
+        auto* in = reinterpret_cast<sockaddr_in*>(&address.storage_);
+        in->sin_family = AF_INET;
+        in->sin_port = htons(port);
+        if (inet_pton(AF_INET, host.c_str(), &in->sin_addr) != 1) {
+            throw std::invalid_argument("Invalid IPv4 address: " + host);
+        }
+        address.length_ = sizeof(sockaddr_in);
+        return address;
+    }
+
+    static SocketAddress ipv6(const std::string& host, uint16_t port) {
+        SocketAddress address;
+        auto* in6 = reinterpret_cast<sockaddr_in6*>(&address.storage_);
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(port);
+        if (inet_pton(AF_INET6, host.c_str(), &in6->sin6_addr) != 1) {
+            throw std::invalid_argument("Invalid IPv6 address: " + host);
+        }
+        address.length_ = sizeof(sockaddr_in6);
+        return address;
+    }
+
+    static SocketAddress any_ipv4(uint16_t port) {
+        return ipv4("0.0.0.0", port);
+    }
+
+    static SocketAddress any_ipv6(uint16_t port) {
+        return ipv6("::", port);
+    }
+
+#ifndef _WIN32
+    static SocketAddress unix_path(const std::string& path) {
+        SocketAddress address;
+        auto* un = reinterpret_cast<sockaddr_un*>(&address.storage_);
+        if (path.empty() || path.size() >= sizeof(un->sun_path)) {
+            throw std::invalid_argument("Invalid Unix socket path: " + path);
+        }
+        un->sun_family = AF_UNIX;
+        std::memcpy(un->sun_path, path.data(), path.size());
+        address.length_ = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size() + 1);
+        return address;
+    }
+#endif
+
+    // "host:port", "[v6host]:port", or a path containing '/' for Unix sockets
+    static SocketAddress parse(const std::string& text) {
+#ifndef _WIN32
+        if (text.find('/') != std::string::npos) {
+            return unix_path(text);
+        }
+#endif
+        size_t colon = text.rfind(':');
+        if (colon == std::string::npos) {
+            throw std::invalid_argument("Missing port in address: " + text);
+        }
+        unsigned long port = std::stoul(text.substr(colon + 1));
+        if (port > UINT16_MAX) {
+            throw std::invalid_argument("Port out of range in address: " + text);
+        }
+        std::string host = text.substr(0, colon);
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+            return ipv6(host.substr(1, host.size() - 2), static_cast<uint16_t>(port));
+        }
+        return ipv4(host, static_cast<uint16_t>(port));
+    }
+
+    // Wraps an address filled in by accept/getsockname
+    static SocketAddress from(const sockaddr* address, socklen_t length) {
+        SocketAddress result;
+        length = std::min<socklen_t>(length, sizeof(result.storage_));
+        std::memcpy(&result.storage_, address, length);
+        result.length_ = length;
+        return result;
+    }
+
+    int family() const { return storage_.ss_family; }
+    bool is_unix() const {
+#ifdef _WIN32
+        return false;
+#else
+        return family() == AF_UNIX;
+#endif
+    }
+
+    const sockaddr* data() const { return reinterpret_cast<const sockaddr*>(&storage_); }
+    sockaddr* data() { return reinterpret_cast<sockaddr*>(&storage_); }
+    socklen_t size() const { return length_; }
+
+    uint16_t port() const {
+        if (family() == AF_INET) {
+            return ntohs(reinterpret_cast<const sockaddr_in*>(&storage_)->sin_port);
+        }
+        if (family() == AF_INET6) {
+            return ntohs(reinterpret_cast<const sockaddr_in6*>(&storage_)->sin6_port);
+        }
+        return 0;
+    }
+
+    bool operator==(const SocketAddress& other) const {
+        return length_ == other.length_ && std::memcmp(&storage_, &other.storage_, length_) == 0;
+    }
+
+    std::string to_string() const {
+        char host[INET6_ADDRSTRLEN] = {};
+        if (family() == AF_INET) {
+            inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(&storage_)->sin_addr,
+                      host, sizeof(host));
+            return std::string(host) + ":" + std::to_string(port());
+        }
+        if (family() == AF_INET6) {
+            inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(&storage_)->sin6_addr,
+                      host, sizeof(host));
+            // Appending avoids GCC 12's false -Wrestrict on "[" + std::string
+            std::string text = "[";
+            text.append(host).append("]:").append(std::to_string(port()));
+            return text;
+        }
+#ifndef _WIN32
+        if (family() == AF_UNIX) {
+            const auto* un = reinterpret_cast<const sockaddr_un*>(&storage_);
+            size_t max = length_ > offsetof(sockaddr_un, sun_path)
+                ? length_ - offsetof(sockaddr_un, sun_path) : 0;
+            return std::string(un->sun_path, strnlen(un->sun_path, max));
+        }
+#endif
+        return "";
+    }
+
+private:
+    sockaddr_storage storage_;
+    socklen_t length_ = 0;
+};
+
+} // namespace async_toolkit::reactor
@@ -0,0 +1,472 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include "protocol.hpp"
+#include "../executor/future.hpp"
+#include "../network/connection.hpp"
+
+namespace async_toolkit::rpc {
+
+struct MultiplexedChannelOptions {
+    // Calls awaiting a response; further calls fail fast until one ends
+    size_t max_in_flight = 1024;
+    // Used by call() without an explicit timeout; zero waits indefinitely
+    std::chrono::milliseconds default_timeout{5000};
+    // Larger incoming frames are a protocol error and close the channel
+    size_t max_frame_size = 16 * 1024 * 1024;
+};
+
+struct MultiplexedChannelStats {
+    size_t in_flight = 0;
+    size_t calls = 0;       // Requests written
+    size_t completed = 0;   // Responses matched to a pending call
+    size_t failed = 0;      // FAILURE responses, and calls ended by a close
+    size_t timeouts = 0;
+    size_t rejected = 0;    // Calls refused at max_in_flight or once closed
+    size_t late = 0;        // Responses to calls that had already ended
+    size_t served = 0;      // Requests handed to the request handler
+};
+
+// Many concurrent RPCs over one Connection. Every call gets a sequence id
+// and a slot in a fixed table of pending calls; the peer answers with the
+// same id, in any order, and the response completes the matching Future.
+// Frames written by any number of callers during one loop iteration join
+// the connection's output queue and leave in a single writev.
+//
+// The table holds max_in_flight slots, rounded up to a power of two and
+// indexed by sequence & mask. Each slot's sequence and state share one
+// atomic word: callers on any thread claim a free slot with a CAS, and
+// responses, timeouts and the close sweep end a call by CASing its exact
+// (sequence, PENDING) word, so a late response can never complete the call
+// that reused the slot. Neither side takes a lock.
+//
+// The same channel serves requests: set_request_handler() receives them and
+// respond()/respond_error() answer, from any thread and in any order.
+// Create channels with std::make_shared and start() them on the loop thread.
+class MultiplexedChannel : public std::enable_shared_from_this<MultiplexedChannel> {
+public:
+    using Ptr = std::shared_ptr<MultiplexedChannel>;
+    // header.service_name points into the input buffer and is only valid
+    // during the call
+    using RequestHandler = std::function<void(const RPCHeaderView& header, std::string body)>;
+
+    MultiplexedChannel(network::Connection::Ptr connection, reactor::EventLoop& loop,
+                       const MultiplexedChannelOptions& options = {})
+        : connection_(std::move(connection)), loop_(loop), options_(options) {
+        options_.max_in_flight = std::max<size_t>(options_.max_in_flight, 1);
+        size_t capacity = 1;
+        while (capacity < options_.max_in_flight) {
+            capacity <<= 1;
+        }
+        slots_ = std::make_unique<Slot[]>(capacity);
+        mask_ = capacity - 1;
+    }
+
+    MultiplexedChannel(const MultiplexedChannel&) = delete;
+    MultiplexedChannel& operator=(const MultiplexedChannel&) = delete;
+
+    // Called on the loop thread for each incoming request
+    void set_request_handler(RequestHandler handler) {
+        request_handler_ = std::move(handler);
+    }
+
+    // Takes over the connection's read and close callbacks
+    void start() {
+        std::weak_ptr<MultiplexedChannel> weak = weak_from_this();
+        connection_->set_read_callback([weak] {
+            if (auto self = weak.lock()) {
+                self->handle_read();
+            }
+        });
+        connection_->set_close_callback([weak] {
+            if (auto self = weak.lock()) {
+                self->handle_close();
+            }
+        });
+        connection_->start();
+        if (!connection_->is_connected()) {
+            handle_close();
+        } else if (!connection_->input().empty()) {
+            handle_read();
+        }
+    }
+
+    // Sends a request; the future yields the response body. It fails with
+    // std::system_error for a timeout (timed_out), a full table
+    // (resource_unavailable_try_again) or a closed channel
+    // (connection_aborted), and with std::runtime_error carrying the
+    // peer's message for a FAILURE response. Safe to call from any thread.
+    executor::Future<std::string> call(std::string_view service, std::string body) {
+        return call(service, std::move(body), options_.default_timeout);
+    }
+
+    executor::Future<std::string> call(std::string_view service, std::string body,
+                                       std::chrono::milliseconds timeout) {
+        return start_call(service, 0, std::move(body), timeout);
+    }
+
+    // Calls a service by its interned id, leaving the name off the wire
+    executor::Future<std::string> call(uint32_t method_id, std::string body,
+                                       std::chrono::milliseconds timeout) {
+        return start_call({}, method_id, std::move(body), timeout);
+    }
+
+    // Answers the request with sequence_id; safe to call from any thread
+    void respond(uint32_t sequence_id, std::string body) {
+        send_reply(FrameType::RESPONSE, sequence_id, std::move(body));
+    }
+
+    // Fails the caller's future with a std::runtime_error holding message
+    void respond_error(uint32_t sequence_id, std::string message) {
+        send_reply(FrameType::FAILURE, sequence_id, std::move(message));
+    }
+
+    // Disconnects and fails every pending call; safe to call from any thread
+    void close() {
+        std::weak_ptr<MultiplexedChannel> weak = weak_from_this();
+        loop_.run_in_loop([weak] {
+            if (auto self = weak.lock()) {
+                self->connection_->disconnect();
+                self->handle_close();
+            }
+        });
+    }
+
+    bool is_open() const { return !closed_.load(std::memory_order_acquire); }
+
+    // Whether another call fits under max_in_flight right now
+    bool has_capacity() const {
+        return is_open() && in_flight() < options_.max_in_flight;
+    }
+
+    size_t in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+
+    const network::Connection::Ptr& connection() const { return connection_; }
+
+    MultiplexedChannelStats stats() const {
+        return MultiplexedChannelStats{
+            .in_flight = in_flight(),
+            .calls = calls_.load(std::memory_order_relaxed),
+            .completed = completed_.load(std::memory_order_relaxed),
+            .failed = failed_.load(std::memory_order_relaxed),
+            .timeouts = timeouts_.load(std::memory_order_relaxed),
+            .rejected = rejected_.load(std::memory_order_relaxed),
+            .late = late_.load(std::memory_order_relaxed),
+            .served = served_.load(std::memory_order_relaxed),
+        };
+    }
+
+private:
+    // Headers up to this size are encoded on the stack
+    static constexpr size_t INLINE_HEADER_SIZE = 128;
+
+    executor::Future<std::string> start_call(std::string_view service, uint32_t method_id,
+                                             std::string body,
+                                             std::chrono::milliseconds timeout) {
+        check_frame(service, body);
+        executor::Promise<std::string> promise;
+        auto future = promise.get_future();
+        if (closed_.load(std::memory_order_acquire) || !reserve()) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            auto code = closed_.load(std::memory_order_relaxed)
+                ? std::errc::connection_aborted : std::errc::resource_unavailable_try_again;
+            promise.set_exception(std::make_exception_ptr(
+                std::system_error(std::make_error_code(code), "RPC call")));
+            return future;
+        }
+        RPCHeaderView header;
+        header.service_name = service;
+        header.sequence_id = claim(std::move(promise));
+        header.timeout_ms = static_cast<uint32_t>(std::max<int64_t>(timeout.count(), 0));
+        header.method_id = method_id;
+        if (loop_.is_in_loop_thread()) {
+            send_request(header, std::move(body), timeout);
+        } else {
+            // The view does not survive the hop; the name travels by value
+            std::weak_ptr<MultiplexedChannel> weak = weak_from_this();
+            loop_.queue_in_loop([weak, header, name = std::string(service),
+                                 body = std::move(body), timeout]() mutable {
+                if (auto self = weak.lock()) {
+                    header.service_name = name;
+                    self->send_request(header, std::move(body), timeout);
+                }
+            });
+        }
+        return future;
+    }
+
+    // Rejects what encode_header could not represent
+    static void check_frame(std::string_view service, const std::string& body) {
+        if (service.size() > MAX_SERVICE_NAME) {
+            throw std::invalid_argument("RPC service name too long");
+        }
+        if (body.size() > UINT32_MAX - MAX_HEADER_SIZE) {
+            throw std::invalid_argument("RPC body too large");
+        }
+    }
+
+    // Low half of a slot word; the high half is the sequence id
+    enum SlotState : uint32_t {
+        FREE = 0,
+        CLAIMED,        // A caller is filling the slot in
+        PENDING,        // Waiting for the response
+        COMPLETING      // Being ended on the loop thread
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> word{FREE};
+        std::optional<executor::Promise<std::string>> promise;
+        reactor::TimerId timer = reactor::INVALID_TIMER;   // Loop thread only
+    };
+
+    static uint64_t pack(uint32_t sequence, SlotState state) {
+        return (static_cast<uint64_t>(sequence) << 32) | state;
+    }
+
+    Slot& slot_for(uint32_t sequence) {
+        return slots_[sequence & mask_];
+    }
+
+    bool reserve() {
+        size_t current = in_flight_.load(std::memory_order_relaxed);
+        while (current < options_.max_in_flight) {
+            if (in_flight_.compare_exchange_weak(current, current + 1, std::memory_order_acquire,
+                                                 std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // A reservation guarantees a free slot exists; sequences that land on a
+    // busy slot are skipped, so a slow call never blocks newer ones
+    uint32_t claim(executor::Promise<std::string>&& promise) {
+        while (true) {
+            uint32_t sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+            Slot& slot = slot_for(sequence);
+            uint64_t current = slot.word.load(std::memory_order_acquire);
+            if (static_cast<uint32_t>(current) == FREE &&
+                slot.word.compare_exchange_strong(current, pack(sequence, CLAIMED),
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_relaxed)) {
+                slot.promise.emplace(std::move(promise));
+                slot.word.store(pack(sequence, PENDING), std::memory_order_release);
+                return sequence;
+            }
+        }
+    }
+
+    // Ends the call if it is still pending; fulfil runs after the slot is
+    // free again, so a continuation may start a new call right away
+    template<typename F>
+    bool finish(uint32_t sequence, F&& fulfil) {
+        Slot& slot = slot_for(sequence);
+        uint64_t expected = pack(sequence, PENDING);
+        if (!slot.word.compare_exchange_strong(expected, pack(sequence, COMPLETING),
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed)) {
+            return false;
+        }
+        if (slot.timer != reactor::INVALID_TIMER) {
+            loop_.cancel_timer(slot.timer);
+            slot.timer = reactor::INVALID_TIMER;
+        }
+        auto promise = std::move(*slot.promise);
+        slot.promise.reset();
+        slot.word.store(pack(sequence, FREE), std::memory_order_release);
+        in_flight_.fetch_sub(1, std::memory_order_release);
+        fulfil(promise);
+        return true;
+    }
+
+    bool fail(uint32_t sequence, std::errc code) {
+        return finish(sequence, [code](executor::Promise<std::string>& promise) {
+            promise.set_exception(std::make_exception_ptr(
+                std::system_error(std::make_error_code(code), "RPC call")));
+        });
+    }
+
+    void send_request(const RPCHeaderView& header, std::string body,
+                      std::chrono::milliseconds timeout) {
+        uint32_t sequence = header.sequence_id;
+        if (closed_.load(std::memory_order_relaxed)) {
+            // Closed after the call was claimed; the sweep may have missed it
+            if (fail(sequence, std::errc::connection_aborted)) {
+                failed_.fetch_add(1, std::memory_order_relaxed);
+            }
+            return;
+        }
+        if (timeout.count() > 0) {
+            std::weak_ptr<MultiplexedChannel> weak = weak_from_this();
+            slot_for(sequence).timer = loop_.run_after(timeout, [weak, sequence] {
+                if (auto self = weak.lock()) {
+                    self->expire(sequence);
+                }
+            });
+        }
+        write_frame(header, std::move(body));
+        calls_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Header and body both land in the output queue; the flush at the end
+    // of the iteration writes them with every other frame queued meanwhile
+    void write_frame(RPCHeaderView header, std::string&& body) {
+        header.body_size = static_cast<uint32_t>(body.size());
+        size_t size = encoded_header_size(header);
+        if (size <= INLINE_HEADER_SIZE) {
+            char buffer[INLINE_HEADER_SIZE];
+            connection_->send(buffer, encode_header(header, buffer, sizeof(buffer)));
+        } else {
+            std::string buffer(size, '\0');
+            connection_->send(buffer.data(), encode_header(header, buffer.data(), size));
+        }
+        connection_->send(std::move(body));
+    }
+
+    void send_reply(FrameType type, uint32_t sequence_id, std::string body) {
+        check_frame({}, body);
+        if (!loop_.is_in_loop_thread()) {
+            std::weak_ptr<MultiplexedChannel> weak = weak_from_this();
+            loop_.queue_in_loop([weak, type, sequence_id, body = std::move(body)]() mutable {
+                if (auto self = weak.lock()) {
+                    self->send_reply(type, sequence_id, std::move(body));
+                }
+            });
+            return;
+        }
+        if (closed_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        RPCHeaderView header;
+        header.type = type;
+        header.sequence_id = sequence_id;
+        write_frame(header, std::move(body));
+    }
+
+    void expire(uint32_t sequence) {
+        if (fail(sequence, std::errc::timed_out)) {
+            timeouts_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static void peek(network::RingBuffer& input, size_t offset, char* out, size_t length) {
+        for (auto region : input.readable_regions(offset, length)) {
+            std::memcpy(out, region.data(), region.size());
+            out += region.size();
+        }
+    }
+
+    // Dispatches every complete frame in the input buffer. Headers are
+    // decoded straight from the ring; only a service name that wraps
+    // around its end is copied out.
+    void handle_read() {
+        auto& input = connection_->input();
+        while (!closed_.load(std::memory_order_relaxed) && input.size() >= FIXED_HEADER_SIZE) {
+            char fixed[FIXED_HEADER_SIZE];
+            peek(input, 0, fixed, sizeof(fixed));
+            RPCHeaderView header;
+            if (!decode_fixed_header(fixed, header) ||
+                static_cast<size_t>(header.header_size) + header.body_size > options_.max_frame_size) {
+                connection_->disconnect();
+                handle_close();
+                return;
+            }
+            size_t frame_size = static_cast<size_t>(header.header_size) + header.body_size;
+            if (input.size() < frame_size) {
+                return;
+            }
+            std::string wrapped_name;
+            size_t name_length = header.header_size - FIXED_HEADER_SIZE;
+            if (name_length > 0) {
+                auto regions = input.readable_regions(FIXED_HEADER_SIZE, name_length);
+                if (regions[1].empty()) {
+                    header.service_name = std::string_view(regions[0].data(), name_length);
+                } else {
+                    wrapped_name.resize(name_length);
+                    peek(input, FIXED_HEADER_SIZE, wrapped_name.data(), name_length);
+                    header.service_name = wrapped_name;
+                }
+            }
+            std::string body(header.body_size, '\0');
+            peek(input, header.header_size, body.data(), body.size());
+            dispatch(header, std::move(body));
+            input.consume(frame_size);
+        }
+    }
+
+    void dispatch(const RPCHeaderView& header, std::string body) {
+        switch (header.type) {
+            case FrameType::REQUEST:
+                served_.fetch_add(1, std::memory_order_relaxed);
+                if (request_handler_) {
+                    request_handler_(header, std::move(body));
+                } else {
+                    respond_error(header.sequence_id, "No request handler");
+                }
+                break;
+            case FrameType::RESPONSE:
+                if (finish(header.sequence_id, [&body](executor::Promise<std::string>& promise) {
+                        promise.set_value(std::move(body));
+                    })) {
+                    completed_.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    late_.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+            case FrameType::FAILURE:
+                if (finish(header.sequence_id, [&body](executor::Promise<std::string>& promise) {
+                        promise.set_exception(std::make_exception_ptr(std::runtime_error(body)));
+                    })) {
+                    failed_.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    late_.fetch_add(1, std::memory_order_relaxed);
+                }
+                break;
+        }
+    }
+
+    // The connection is gone: fail everything still pending. Calls claimed
+    // concurrently are failed by send_request, which checks closed_.
+    void handle_close() {
+        if (closed_.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+        for (size_t i = 0; i <= mask_; ++i) {
+            uint64_t word = slots_[i].word.load(std::memory_order_acquire);
+            if (static_cast<uint32_t>(word) == PENDING &&
+                fail(static_cast<uint32_t>(word >> 32), std::errc::connection_aborted)) {
+                failed_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    network::Connection::Ptr connection_;
+    reactor::EventLoop& loop_;
+    MultiplexedChannelOptions options_;
+    RequestHandler request_handler_;
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    std::atomic<uint32_t> next_sequence_{0};
+    std::atomic<size_t> in_flight_{0};
+    std::atomic<bool> closed_{false};
+    std::atomic<size_t> calls_{0};
+    std::atomic<size_t> completed_{0};
+    std::atomic<size_t> failed_{0};
+    std::atomic<size_t> timeouts_{0};
+    std::atomic<size_t> rejected_{0};
+    std::atomic<size_t> late_{0};
+    std::atomic<size_t> served_{0};
+};
+
+} // namespace async_toolkit::rpc
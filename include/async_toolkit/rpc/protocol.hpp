@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace async_toolkit::rpc {
+
+// RPC message header
+struct RPCHeader {
+    std::string service_name;
+    uint32_t header_size = 0;
+    uint32_t body_size = 0;
+    uint32_t sequence_id = 0;
+    uint32_t timeout_ms = 0;
+    uint32_t method_id = 0;     // Interned service id; 0 means use service_name
+};
+
+enum class FrameType : uint8_t {
+    REQUEST = 0,
+    RESPONSE = 1,
+    FAILURE = 2     // Response whose body is an error message
+};
+
+// Decoded header whose service name points into the buffer it was decoded
+// from, so it is only valid as long as that buffer
+struct RPCHeaderView {
+    FrameType type = FrameType::REQUEST;
+    std::string_view service_name;
+    uint32_t header_size = 0;
+    uint32_t body_size = 0;
+    uint32_t sequence_id = 0;
+    uint32_t timeout_ms = 0;
+    uint32_t method_id = 0;
+};
+
+// Wire header, all integers little-endian:
+//
+//   0  u32 frame length      bytes after this field
+//   4  u8  frame type
+//   5  u8  reserved, 0
+//   6  u16 service name length
+//   8  u32 sequence id       echoed back in the response
+//   12 u32 timeout in ms     0 means none
+//   16 u32 method id
+//   20 service name, then body
+//
+// The fixed part never changes size, so a reader needs FIXED_HEADER_SIZE
+// bytes to learn the size of the whole frame. Callers that intern their
+// services send a method id and an empty name, making the header fixed-size.
+constexpr size_t FRAME_LENGTH_SIZE = 4;
+constexpr size_t FIXED_HEADER_SIZE = 20;
+constexpr size_t MAX_SERVICE_NAME = UINT16_MAX;
+constexpr size_t MAX_HEADER_SIZE = FIXED_HEADER_SIZE + MAX_SERVICE_NAME;
+
+namespace detail {
+
+inline void store_le16(char* out, uint16_t value) {
+    out[0] = static_cast<char>(value);
+    out[1] = static_cast<char>(value >> 8);
+}
+
+inline void store_le32(char* out, uint32_t value) {
+    out[0] = static_cast<char>(value);
+    out[1] = static_cast<char>(value >> 8);
+    out[2] = static_cast<char>(value >> 16);
+    out[3] = static_cast<char>(value >> 24);
+}
+
+inline uint16_t load_le16(const char* in) {
+    auto* bytes = reinterpret_cast<const unsigned char*>(in);
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+inline uint32_t load_le32(const char* in) {
+    auto* bytes = reinterpret_cast<const unsigned char*>(in);
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+           (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+} // namespace detail
+
+inline size_t encoded_header_size(const RPCHeaderView& header) {
+    return FIXED_HEADER_SIZE + header.service_name.size();
+}
+
+// Writes the header of a frame carrying header.body_size bytes into out.
+// Returns the bytes written, or 0 if out is too small or the service name
+// is longer than MAX_SERVICE_NAME. header_size is ignored.
+inline size_t encode_header(const RPCHeaderView& header, char* out, size_t capacity) {
+    size_t size = encoded_header_size(header);
+    uint64_t frame_length = size - FRAME_LENGTH_SIZE + uint64_t{header.body_size};
+    if (size > capacity || header.service_name.size() > MAX_SERVICE_NAME ||
+        frame_length > UINT32_MAX) {
+        return 0;
+    }
+    detail::store_le32(out, static_cast<uint32_t>(frame_length));
+    out[4] = static_cast<char>(header.type);
+    out[5] = 0;
+    detail::store_le16(out + 6, static_cast<uint16_t>(header.service_name.size()));
+    detail::store_le32(out + 8, header.sequence_id);
+    detail::store_le32(out + 12, header.timeout_ms);
+    detail::store_le32(out + 16, header.method_id);
+    header.service_name.copy(out + FIXED_HEADER_SIZE, header.service_name.size());
+    return size;
+}
+
+// Parses the fixed part from FIXED_HEADER_SIZE bytes at data. Sets every
+// field but service_name; header_size tells how many bytes the whole
+// header takes. False for an unknown type or a frame too short to hold
+// its own header.
+inline bool decode_fixed_header(const char* data, RPCHeaderView& header) {
+    auto type = static_cast<uint8_t>(data[4]);
+    if (type > static_cast<uint8_t>(FrameType::FAILURE)) {
+        return false;
+    }
+    header.type = static_cast<FrameType>(type);
+    header.service_name = {};
+    header.header_size = static_cast<uint32_t>(FIXED_HEADER_SIZE + detail::load_le16(data + 6));
+    header.sequence_id = detail::load_le32(data + 8);
+    header.timeout_ms = detail::load_le32(data + 12);
+    header.method_id = detail::load_le32(data + 16);
+    uint64_t total = uint64_t{detail::load_le32(data)} + FRAME_LENGTH_SIZE;
+    if (total < header.header_size) {
+        return false;
+    }
+    header.body_size = static_cast<uint32_t>(total - header.header_size);
+    return true;
+}
+
+// Decodes a whole header in place; service_name points into data. False
+// if the header is malformed or size is less than its header_size.
+inline bool decode_header(const char* data, size_t size, RPCHeaderView& header) {
+    if (size < FIXED_HEADER_SIZE || !decode_fixed_header(data, header) ||
+        size < header.header_size) {
+        return false;
+    }
+    header.service_name = std::string_view(data + FIXED_HEADER_SIZE,
+                                           header.header_size - FIXED_HEADER_SIZE);
+    return true;
+}
+
+// Owning conveniences over the codec above, for request headers
+inline std::string serialize_header(const RPCHeader& header) {
+    RPCHeaderView view{FrameType::REQUEST, header.service_name, 0, header.body_size,
+                       header.sequence_id, header.timeout_ms, header.method_id};
+    std::string out(encoded_header_size(view), '\0');
+    out.resize(encode_header(view, out.data(), out.size()));
+    return out;
+}
+
+inline bool deserialize_header(const std::string& data, RPCHeader& header) {
+    RPCHeaderView view;
+    if (!decode_header(data.data(), data.size(), view)) {
+        return false;
+    }
+    header.service_name.assign(view.service_name);
+    header.header_size = view.header_size;
+    header.body_size = view.body_size;
+    header.sequence_id = view.sequence_id;
+    header.timeout_ms = view.timeout_ms;
+    header.method_id = view.method_id;
+    return true;
+}
+
+} // namespace async_toolkit::rpc
@@ -7,6 +7,7 @@
 #include <msgpack.hpp>
 #include <google/protobuf/message.h>
 #include <flatbuffers/flatbuffers.h>
+#include "protocol.hpp"
 
 namespace async_toolkit::rpc {
 
@@ -124,32 +125,4 @@ create_serializer(SerializationType type) {
     }
 }
 
-// RPC message header
-struct RPCHeader {
-    std::string service_name;
-    uint32_t header_size;
-    uint32_t body_size;
-    uint32_t sequence_id;
-    uint32_t timeout_ms;
-};
-
-// Serialize header
-inline std::string serialize_header(const RPCHeader& header) {
-    msgpack::sbuffer sbuf;
-    msgpack::pack(sbuf, header);
-    return std::string(sbuf.data(), sbuf.size());
-}
-
-// Deserialize header
-inline bool deserialize_header(const std::string& data, RPCHeader& header) {
-    try {
-        msgpack::object_handle oh = 
-            msgpack::unpack(data.data(), data.size());
-        oh.get().convert(header);
-        return true;
-    } catch (...) {
-        return false;
-    }
-}
-
 } // namespace async_toolkit::rpc
@@ -10,14 +10,28 @@
 #include <atomic>
 #include <memory>
 #include <vector>
+#include <random>
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <cmath>
+#include <stdexcept>
+#include "../executor/unique_function.hpp"
 
 namespace async_toolkit::scheduler {
 
+// Queue organisation used by PriorityScheduler
+enum class SchedulingMode {
+    EXACT,          // Single heap, tasks are popped in strict priority order
+    MULTI_QUEUE     // c*P heaps, relaxed priority order for many-core scaling
+};
+
 struct Task {
-    std::function<void()> func;
+    executor::UniqueFunction<void()> func;
     int priority;
     std::chrono::steady_clock::time_point schedule_time;
     size_t task_id;
+    std::chrono::steady_clock::time_point deadline{};
 
     bool operator<(const Task& other) const {
         if (priority != other.priority)
@@ -26,10 +40,101 @@ struct Task {
     }
 };
 
+// Budget of a rate-limited task class (e.g. one tenant's background jobs)
+struct TaskClassOptions {
+    double rate_per_second = 0.0;   // Token refill rate, 0 means unlimited
+    double burst = 1.0;             // Token bucket capacity
+    double max_worker_share = 1.0;  // Fraction of workers the class may occupy
+};
+
+// Per-class statistics. Lateness is measured when a task starts: against
+// its deadline for EDF tasks, against the time it became ready otherwise.
+struct ClassStats {
+    size_t queue_depth = 0;
+    size_t executed = 0;
+    size_t missed_deadlines = 0;
+    std::chrono::nanoseconds total_lateness{0};
+    std::chrono::nanoseconds max_lateness{0};
+};
+
 class PriorityScheduler {
+    using Clock = std::chrono::steady_clock;
+
+    // Guarded by the lock of the queue the tasks are popped from
+    struct LatenessStats {
+        size_t executed = 0;
+        size_t missed_deadlines = 0;
+        Clock::duration total_lateness{0};
+        Clock::duration max_lateness{0};
+
+        void record(Clock::duration lateness, bool missed) {
+            ++executed;
+            missed_deadlines += missed;
+            total_lateness += lateness;
+            max_lateness = std::max(max_lateness, lateness);
+        }
+
+        void add_to(ClassStats& stats) const {
+            stats.executed += executed;
+            stats.missed_deadlines += missed_deadlines;
+            stats.total_lateness += total_lateness;
+            stats.max_lateness = std::max<std::chrono::nanoseconds>(stats.max_lateness,
+                                                                    max_lateness);
+        }
+    };
+
+    struct EarliestDeadlineFirst {
+        bool operator()(const Task& a, const Task& b) const {
+            return a.deadline > b.deadline;
+        }
+    };
+
+    // Token bucket plus concurrency cap for one task class
+    struct RateClass {
+        mutable std::mutex mutex;
+        std::deque<Task> tasks;
+        TaskClassOptions options;
+        size_t max_running = 1;
+        size_t running = 0;
+        double tokens = 0.0;
+        Clock::time_point last_refill;
+        LatenessStats stats;
+        std::atomic<size_t> depth{0};
+    };
+
+    // One heap of the MultiQueue. The key of the top task is mirrored into
+    // atomics so poppers can compare two heaps without taking either lock.
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::priority_queue<Task> tasks;
+        LatenessStats stats;
+        std::atomic<bool> has_top{false};
+        std::atomic<int> top_priority{0};
+        std::atomic<Clock::rep> top_time{0};
+
+        // Must be called with mutex held after every change to tasks
+        void publish_top() {
+            if (tasks.empty()) {
+                has_top.store(false, std::memory_order_relaxed);
+                return;
+            }
+            top_priority.store(tasks.top().priority, std::memory_order_relaxed);
+            top_time.store(tasks.top().schedule_time.time_since_epoch().count(),
+                           std::memory_order_relaxed);
+            has_top.store(true, std::memory_order_release);
+        }
+    };
+
 public:
-    explicit PriorityScheduler(size_t thread_count = std::thread::hardware_concurrency())
-        : stop_(false), next_task_id_(0) {
+    static constexpr size_t MAX_TASK_CLASSES = 64;
+
+    explicit PriorityScheduler(size_t thread_count = std::thread::hardware_concurrency(),
+                               SchedulingMode mode = SchedulingMode::EXACT,
+                               size_t queues_per_thread = 2)
+        : mode_(mode),
+          shards_(mode == SchedulingMode::EXACT
+                      ? 1 : std::max<size_t>(2, thread_count * queues_per_thread)),
+          stop_(false), next_task_id_(0) {
         for (size_t i = 0; i < thread_count; ++i) {
             workers_.emplace_back([this] { worker_loop(); });
         }
@@ -37,7 +142,7 @@ public:
 
     ~PriorityScheduler() {
         {
-            std::unique_lock lock(mutex_);
+            std::unique_lock lock(sleep_mutex_);
             stop_ = true;
         }
         condition_.notify_all();
@@ -48,7 +153,7 @@ public:
 
     template<typename F>
     size_t schedule(F&& func, int priority = 0) {
-        return schedule_at(std::forward<F>(func), 
+        return schedule_at(std::forward<F>(func),
                          std::chrono::steady_clock::now(),
                          priority);
     }
@@ -72,24 +177,252 @@ public:
             .schedule_time = time,
             .task_id = next_task_id_++
         };
+        size_t task_id = task.task_id;
+
+        pending_.fetch_add(1);
+        Shard& shard = lock_shard_for_push();
+        shard.tasks.push(std::move(task));
+        shard.publish_top();
+        shard.mutex.unlock();
+
+        notify_push();
+        return task_id;
+    }
+
+    // Earliest-deadline-first class. Deadline tasks are served before
+    // rate-limited and priority tasks, ordered by due time, up to the
+    // deadline burst (see set_deadline_burst).
+    template<typename F>
+    size_t schedule_with_deadline(F&& func,
+                                  const std::chrono::steady_clock::time_point& deadline) {
+        Task task{
+            .func = std::forward<F>(func),
+            .priority = 0,
+            .schedule_time = std::chrono::steady_clock::now(),
+            .task_id = next_task_id_++,
+            .deadline = deadline
+        };
+        size_t task_id = task.task_id;
 
+        pending_.fetch_add(1);
         {
-            std::unique_lock lock(mutex_);
-            tasks_.push(std::move(task));
+            std::lock_guard lock(deadline_mutex_);
+            deadline_tasks_.push(std::move(task));
+            deadline_pending_.fetch_add(1);
         }
-        condition_.notify_one();
-        return task.task_id;
+        notify_push();
+        return task_id;
+    }
+
+    template<typename F, typename Rep, typename Period>
+    size_t schedule_within(F&& func, const std::chrono::duration<Rep, Period>& budget) {
+        return schedule_with_deadline(std::forward<F>(func),
+                                      std::chrono::steady_clock::now() + budget);
+    }
+
+    // After this many deadline tasks in a row, a worker serves one ready
+    // class or priority task before the next deadline task, so a steady
+    // stream of deadline work cannot starve the other classes. Zero gives
+    // deadline tasks absolute priority.
+    void set_deadline_burst(size_t burst) {
+        deadline_burst_.store(burst, std::memory_order_relaxed);
+    }
+
+    // Registers a rate-limited task class and returns its id
+    size_t add_task_class(const TaskClassOptions& options) {
+        std::lock_guard registry_lock(class_registry_mutex_);
+        size_t class_id = class_count_.load();
+        if (class_id == MAX_TASK_CLASSES) {
+            throw std::runtime_error("Too many task classes");
+        }
+
+        RateClass& rate_class = classes_[class_id];
+        {
+            std::lock_guard lock(rate_class.mutex);
+            rate_class.options = options;
+            rate_class.max_running = std::max<size_t>(1, static_cast<size_t>(
+                std::ceil(options.max_worker_share * static_cast<double>(workers_.size()))));
+            rate_class.tokens = std::max(1.0, options.burst);
+            rate_class.last_refill = Clock::now();
+        }
+        class_count_.store(class_id + 1, std::memory_order_release);
+        return class_id;
+    }
+
+    template<typename F>
+    size_t schedule_in_class(size_t class_id, F&& func) {
+        check_task_class(class_id);
+        RateClass& rate_class = classes_[class_id];
+        Task task{
+            .func = std::forward<F>(func),
+            .priority = 0,
+            .schedule_time = std::chrono::steady_clock::now(),
+            .task_id = next_task_id_++
+        };
+        size_t task_id = task.task_id;
+
+        pending_.fetch_add(1);
+        {
+            std::lock_guard lock(rate_class.mutex);
+            rate_class.tasks.push_back(std::move(task));
+            rate_class.depth.fetch_add(1);
+        }
+        notify_push();
+        return task_id;
     }
 
     bool cancel(size_t task_id) {
-        std::unique_lock lock(mutex_);
+        if (cancel_deadline(task_id)) {
+            return true;
+        }
+        for (size_t i = 0; i < class_count_.load(std::memory_order_acquire); ++i) {
+            RateClass& rate_class = classes_[i];
+            std::unique_lock lock(rate_class.mutex);
+            auto it = std::find_if(rate_class.tasks.begin(), rate_class.tasks.end(),
+                                   [task_id](const Task& task) { return task.task_id == task_id; });
+            if (it != rate_class.tasks.end()) {
+                rate_class.tasks.erase(it);
+                rate_class.depth.fetch_sub(1);
+                lock.unlock();
+                release_pending();
+                return true;
+            }
+        }
+
+        for (auto& shard : shards_) {
+            std::unique_lock lock(shard.mutex);
+            std::vector<Task> temp;
+            bool found = false;
+
+            while (!shard.tasks.empty()) {
+                auto task = std::move(const_cast<Task&>(shard.tasks.top()));
+                shard.tasks.pop();
+
+                if (task.task_id != task_id) {
+                    temp.push_back(std::move(task));
+                } else {
+                    found = true;
+                }
+            }
+
+            for (auto& task : temp) {
+                shard.tasks.push(std::move(task));
+            }
+            shard.publish_top();
+
+            if (found) {
+                lock.unlock();
+                release_pending();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t pending_tasks() const {
+        return pending_.load();
+    }
+
+    SchedulingMode mode() const {
+        return mode_;
+    }
+
+    ClassStats priority_stats() const {
+        ClassStats stats;
+        for (const auto& shard : shards_) {
+            std::lock_guard lock(shard.mutex);
+            stats.queue_depth += shard.tasks.size();
+            shard.stats.add_to(stats);
+        }
+        return stats;
+    }
+
+    ClassStats deadline_stats() const {
+        std::lock_guard lock(deadline_mutex_);
+        ClassStats stats;
+        stats.queue_depth = deadline_tasks_.size();
+        deadline_lateness_.add_to(stats);
+        return stats;
+    }
+
+    ClassStats class_stats(size_t class_id) const {
+        check_task_class(class_id);
+        const RateClass& rate_class = classes_[class_id];
+        std::lock_guard lock(rate_class.mutex);
+        ClassStats stats;
+        stats.queue_depth = rate_class.tasks.size();
+        rate_class.stats.add_to(stats);
+        return stats;
+    }
+
+private:
+    static bool due(const Task& task, Clock::time_point now) {
+        return task.schedule_time <= now;
+    }
+
+    // Higher priority wins, ties go to the earlier schedule time
+    static bool better(int priority_a, Clock::rep time_a, int priority_b, Clock::rep time_b) {
+        if (priority_a != priority_b)
+            return priority_a > priority_b;
+        return time_a < time_b;
+    }
+
+    size_t random_shard() {
+        thread_local static std::random_device rd;
+        thread_local static std::mt19937 gen(rd());
+        return std::uniform_int_distribution<size_t>(0, shards_.size() - 1)(gen);
+    }
+
+    // Returns a shard whose mutex is held by the caller
+    Shard& lock_shard_for_push() {
+        if (mode_ == SchedulingMode::EXACT) {
+            shards_[0].mutex.lock();
+            return shards_[0];
+        }
+        for (size_t attempt = 0; attempt < shards_.size(); ++attempt) {
+            Shard& shard = shards_[random_shard()];
+            if (shard.mutex.try_lock()) {
+                return shard;
+            }
+        }
+        Shard& shard = shards_[random_shard()];
+        shard.mutex.lock();
+        return shard;
+    }
+
+    // Pops the top of a shard if it is due; otherwise lowers next_due to its
+    // schedule time. Must be called with the shard's mutex held.
+    bool pop_locked(Shard& shard, Task& task, Clock::time_point now,
+                    Clock::time_point& next_due) {
+        if (shard.tasks.empty()) {
+            return false;
+        }
+        if (!due(shard.tasks.top(), now)) {
+            next_due = std::min(next_due, shard.tasks.top().schedule_time);
+            return false;
+        }
+        task = std::move(const_cast<Task&>(shard.tasks.top()));
+        shard.tasks.pop();
+        shard.publish_top();
+        shard.stats.record(now - task.schedule_time, false);
+        return true;
+    }
+
+    void check_task_class(size_t class_id) const {
+        if (class_id >= class_count_.load(std::memory_order_acquire)) {
+            throw std::out_of_range("Unknown task class");
+        }
+    }
+
+    bool cancel_deadline(size_t task_id) {
+        std::unique_lock lock(deadline_mutex_);
         std::vector<Task> temp;
         bool found = false;
 
-        while (!tasks_.empty()) {
-            auto task = std::move(const_cast<Task&>(tasks_.top()));
-            tasks_.pop();
-            
+        while (!deadline_tasks_.empty()) {
+            auto task = std::move(const_cast<Task&>(deadline_tasks_.top()));
+            deadline_tasks_.pop();
+
             if (task.task_id != task_id) {
                 temp.push_back(std::move(task));
             } else {
@@ -98,48 +431,236 @@ public:
         }
 
         for (auto& task : temp) {
-            tasks_.push(std::move(task));
+            deadline_tasks_.push(std::move(task));
         }
 
+        if (found) {
+            deadline_pending_.fetch_sub(1);
+            lock.unlock();
+            release_pending();
+        }
         return found;
     }
 
-    size_t pending_tasks() const {
-        std::unique_lock lock(mutex_);
-        return tasks_.size();
+    bool try_pop_deadline(Task& task) {
+        if (deadline_pending_.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+
+        std::unique_lock lock(deadline_mutex_);
+        if (deadline_tasks_.empty()) {
+            return false;
+        }
+        task = std::move(const_cast<Task&>(deadline_tasks_.top()));
+        deadline_tasks_.pop();
+        deadline_pending_.fetch_sub(1);
+
+        auto lateness = Clock::now() - task.deadline;
+        deadline_lateness_.record(std::max(lateness, Clock::duration::zero()),
+                                  lateness > Clock::duration::zero());
+        lock.unlock();
+        release_pending();
+        return true;
     }
 
-private:
-    void worker_loop() {
-        while (true) {
-            std::unique_lock lock(mutex_);
-            
-            condition_.wait(lock, [this] {
-                return stop_ || (!tasks_.empty() && 
-                       tasks_.top().schedule_time <= std::chrono::steady_clock::now());
-            });
-
-            if (stop_ && tasks_.empty()) {
-                return;
+    // Round-robin over the task classes, taking a task from the first class
+    // that is under its worker cap and has a token available. A class that is
+    // only short of tokens lowers next_due to its next refill.
+    bool try_pop_class(Task& task, Clock::time_point& next_due, RateClass*& taken_from) {
+        size_t count = class_count_.load(std::memory_order_acquire);
+        if (count == 0) {
+            return false;
+        }
+
+        size_t start = next_class_.fetch_add(1, std::memory_order_relaxed);
+        auto now = Clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            RateClass& rate_class = classes_[(start + i) % count];
+            if (rate_class.depth.load(std::memory_order_relaxed) == 0) {
+                continue;
+            }
+
+            std::unique_lock lock(rate_class.mutex);
+            if (rate_class.tasks.empty() || rate_class.running >= rate_class.max_running) {
+                continue;
+            }
+
+            double capacity = std::max(1.0, rate_class.options.burst);
+            double rate = rate_class.options.rate_per_second;
+            if (rate <= 0.0) {
+                rate_class.tokens = capacity;
+            } else {
+                std::chrono::duration<double> elapsed = now - rate_class.last_refill;
+                rate_class.tokens = std::min(capacity, rate_class.tokens + elapsed.count() * rate);
+            }
+            rate_class.last_refill = now;
+
+            if (rate_class.tokens < 1.0) {
+                auto wait = std::chrono::duration<double>((1.0 - rate_class.tokens) / rate);
+                next_due = std::min(next_due,
+                                    now + std::chrono::ceil<Clock::duration>(wait));
+                continue;
             }
 
-            if (!tasks_.empty() && 
-                tasks_.top().schedule_time <= std::chrono::steady_clock::now()) {
-                auto task = std::move(const_cast<Task&>(tasks_.top()));
-                tasks_.pop();
+            rate_class.tokens -= 1.0;
+            ++rate_class.running;
+            task = std::move(rate_class.tasks.front());
+            rate_class.tasks.pop_front();
+            rate_class.depth.fetch_sub(1);
+            rate_class.stats.record(now - task.schedule_time, false);
+            lock.unlock();
+
+            taken_from = &rate_class;
+            release_pending();
+            return true;
+        }
+        return false;
+    }
+
+    // A finished class task frees a worker slot, which may unblock the class
+    void finish_class_task(RateClass& rate_class) {
+        bool more;
+        {
+            std::lock_guard lock(rate_class.mutex);
+            --rate_class.running;
+            more = !rate_class.tasks.empty();
+        }
+        if (more) {
+            notify_push();
+        }
+    }
+
+    // "Power of two choices": compare the cached tops of two random shards
+    // and pop from the better one. Falls back to a full scan before giving
+    // up so a worker never sleeps while a due task is queued.
+    bool try_pop_priority(Task& task, Clock::time_point& next_due) {
+        auto now = Clock::now();
+
+        if (mode_ == SchedulingMode::MULTI_QUEUE) {
+            for (size_t attempt = 0; attempt < shards_.size(); ++attempt) {
+                if (pending_.load(std::memory_order_relaxed) == 0) {
+                    break;
+                }
+
+                Shard* candidates[2] = {&shards_[random_shard()], &shards_[random_shard()]};
+                Shard* best = nullptr;
+                for (Shard* shard : candidates) {
+                    if (!shard->has_top.load(std::memory_order_acquire) ||
+                        shard->top_time.load(std::memory_order_relaxed) >
+                            now.time_since_epoch().count()) {
+                        continue;
+                    }
+                    if (!best || better(shard->top_priority.load(std::memory_order_relaxed),
+                                        shard->top_time.load(std::memory_order_relaxed),
+                                        best->top_priority.load(std::memory_order_relaxed),
+                                        best->top_time.load(std::memory_order_relaxed))) {
+                        best = shard;
+                    }
+                }
+
+                if (best && best->mutex.try_lock()) {
+                    bool popped = pop_locked(*best, task, now, next_due);
+                    best->mutex.unlock();
+                    if (popped) {
+                        release_pending();
+                        return true;
+                    }
+                }
+            }
+        }
+
+        for (auto& shard : shards_) {
+            std::unique_lock lock(shard.mutex);
+            if (pop_locked(shard, task, now, next_due)) {
                 lock.unlock();
+                release_pending();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Wakes workers blocked in shutdown once the last queued task is gone
+    void release_pending() {
+        if (pending_.fetch_sub(1) == 1 && stop_) {
+            { std::lock_guard lock(sleep_mutex_); }
+            condition_.notify_all();
+        }
+    }
+
+    void notify_push() {
+        epoch_.fetch_add(1);
+        if (sleepers_.load() > 0) {
+            { std::lock_guard lock(sleep_mutex_); }
+            condition_.notify_one();
+        }
+    }
+
+    void worker_loop() {
+        size_t deadline_streak = 0;
+        while (true) {
+            uint64_t epoch = epoch_.load();
+            Clock::time_point next_due = Clock::time_point::max();
+            Task task;
+            RateClass* rate_class = nullptr;
 
+            // Past the burst, deadline tasks wait behind one other task
+            size_t burst = deadline_burst_.load(std::memory_order_relaxed);
+            bool deadline_first = burst == 0 || deadline_streak < burst;
+            bool from_deadline = deadline_first && try_pop_deadline(task);
+            bool popped = from_deadline ||
+                          try_pop_class(task, next_due, rate_class) ||
+                          try_pop_priority(task, next_due);
+            if (!popped && !deadline_first) {
+                popped = from_deadline = try_pop_deadline(task);
+            }
+
+            if (popped) {
+                deadline_streak = from_deadline ? deadline_streak + 1 : 0;
                 try {
                     task.func();
                 } catch (...) {
                     // Log exception or handle error
                 }
+                if (rate_class) {
+                    finish_class_task(*rate_class);
+                }
+                continue;
+            }
+
+            std::unique_lock lock(sleep_mutex_);
+            if (stop_ && pending_.load() == 0) {
+                return;
+            }
+
+            sleepers_.fetch_add(1);
+            auto woken = [this, epoch] {
+                return (stop_ && pending_.load() == 0) || epoch_.load() != epoch;
+            };
+            if (next_due == Clock::time_point::max()) {
+                condition_.wait(lock, woken);
+            } else {
+                condition_.wait_until(lock, next_due, woken);
             }
+            sleepers_.fetch_sub(1);
         }
     }
 
-    std::priority_queue<Task> tasks_;
-    mutable std::mutex mutex_;
+    const SchedulingMode mode_;
+    std::vector<Shard> shards_;
+    std::priority_queue<Task, std::vector<Task>, EarliestDeadlineFirst> deadline_tasks_;
+    mutable std::mutex deadline_mutex_;
+    std::atomic<size_t> deadline_pending_{0};
+    std::atomic<size_t> deadline_burst_{16};
+    LatenessStats deadline_lateness_;
+    std::array<RateClass, MAX_TASK_CLASSES> classes_;
+    std::atomic<size_t> class_count_{0};
+    std::atomic<size_t> next_class_{0};
+    std::mutex class_registry_mutex_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<uint64_t> epoch_{0};
+    std::atomic<size_t> sleepers_{0};
+    std::mutex sleep_mutex_;
     std::condition_variable condition_;
     std::vector<std::thread> workers_;
     std::atomic<bool> stop_;
@@ -9,6 +9,7 @@
 #include <functional>
 #include <condition_variable>
 #include "../memory/memory_pool.hpp"
+#include "../executor/unique_function.hpp"
 
 namespace async_toolkit::scheduler {
 
@@ -54,14 +55,13 @@ private:
 
 class WorkStealingScheduler {
 public:
-    using Task = std::function<void()>;
+    using Task = executor::UniqueFunction<void()>;
 
     explicit WorkStealingScheduler(size_t thread_count = std::thread::hardware_concurrency())
         : queues_(thread_count), threads_(thread_count), running_(true) {
         
-        // Initialize thread-local index
         thread_index_ = 0;
-        
+
         // Create worker threads
         for (size_t i = 0; i < threads_.size(); ++i) {
             threads_[i] = std::thread([this, i] { worker_loop(i); });
@@ -69,7 +69,10 @@ public:
     }
 
     ~WorkStealingScheduler() {
-        running_ = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
         cv_.notify_all();
         
         for (auto& thread : threads_) {
@@ -79,16 +82,22 @@ public:
         }
     }
 
-    // Submit task, returns the current thread's queue index
+    // Submit task to the calling worker's own queue, or spread across queues
+    // when called from outside the scheduler
     void submit(Task task) {
         size_t index = get_worker_index();
         queues_[index].push(std::move(task));
-        cv_.notify_one();
+        wake_one();
+    }
+
+    // Executor interface, lets futures and task graphs run on this scheduler
+    void post(Task task) {
+        submit(std::move(task));
     }
 
     // Submit task with priority
     void submit_with_priority(Task task, int priority) {
-        auto wrapped_task = [task = std::move(task), priority] {
+        auto wrapped_task = [task = std::move(task), priority]() mutable {
             std::this_thread::yield();  // Yield CPU to higher priority tasks
             task();
         };
@@ -117,6 +126,9 @@ public:
             current_queue = (current_queue + 1) % queues_.size();
         }
         
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
         cv_.notify_all();
     }
 
@@ -133,6 +145,7 @@ public:
 
 private:
     void worker_loop(size_t index) {
+        current_ = {this, index};
         thread_local static std::random_device rd;
         thread_local static std::mt19937 gen(rd());
         
@@ -162,10 +175,27 @@ private:
     }
 
     size_t get_worker_index() {
-        thread_local static size_t index = thread_index_++;
-        return index % queues_.size();
+        if (current_.scheduler == this) {
+            return current_.index;
+        }
+        return thread_index_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    }
+
+    // Taking the mutex orders the push before a worker's predicate check, so
+    // a worker about to sleep cannot miss the notification
+    void wake_one() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+        cv_.notify_one();
     }
 
+    struct WorkerSlot {
+        WorkStealingScheduler* scheduler;
+        size_t index;
+    };
+    static inline thread_local WorkerSlot current_{nullptr, 0};
+
     std::vector<WorkStealingQueue<Task>> queues_;
     std::vector<std::thread> threads_;
     std::atomic<bool> running_;
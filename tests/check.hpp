@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal assertions for the test programs: a failed CHECK prints where it
+// failed and makes test_result() return 1
+namespace async_toolkit::test {
+
+inline int failures = 0;
+
+inline int test_result(const char* name) {
+    if (failures == 0) {
+        std::printf("%s passed\n", name);
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace async_toolkit::test
+
+#define CHECK(condition)                                                         \
+    do {                                                                         \
+        if (!(condition)) {                                                      \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                         #condition);                                            \
+            ++async_toolkit::test::failures;                                     \
+        }                                                                        \
+    } while (0)
@@ -0,0 +1,274 @@
+// Drives a ConnectionPool against a local TcpServer from the main thread
+// while the loop runs on its own: dialing up to max_size, waiting and
+// timing out, failed dials, eviction, the pool going away under its
+// waiters, and the per-thread caches.
+
+#include <async_toolkit/network/connection_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "check.hpp"
+
+using namespace async_toolkit;
+using namespace std::chrono_literals;
+
+// A listening server and a pool on one loop thread
+class PoolFixture {
+public:
+    explicit PoolFixture(const network::ConnectionPoolOptions& options)
+        : server_(loop_, reactor::SocketAddress::ipv4("127.0.0.1", 0)),
+          endpoint_(server_.address()),
+          pool_(std::make_unique<network::ConnectionPool>(loop_, options)) {
+        server_.set_connection_callback([this](reactor::FileDescriptor fd) {
+            accepted_.push_back(fd);
+        });
+        thread_ = std::thread([this] { loop_.run(); });
+    }
+
+    ~PoolFixture() {
+        destroy_pool();
+        loop_.stop();
+        thread_.join();
+        for (reactor::FileDescriptor fd : accepted_) {
+            close(fd);
+        }
+    }
+
+    network::ConnectionPool& pool() { return *pool_; }
+
+    void destroy_pool() {
+        on_loop([this] { pool_.reset(); });
+    }
+
+    const reactor::SocketAddress& endpoint() const { return endpoint_; }
+
+    // Starts an acquire; the future yields its callback's argument
+    std::future<network::Connection::Ptr> acquire(const reactor::SocketAddress& endpoint,
+                                                  std::chrono::milliseconds timeout = 2000ms) {
+        auto promise = std::make_shared<std::promise<network::Connection::Ptr>>();
+        auto future = promise->get_future();
+        pool_->acquire(endpoint, [promise](network::Connection::Ptr connection) {
+            promise->set_value(std::move(connection));
+        }, timeout);
+        return future;
+    }
+
+    network::Connection::Ptr acquire() {
+        return acquire(endpoint_).get();
+    }
+
+    // Runs f on the loop thread and waits for it
+    template<typename F>
+    void on_loop(F f) {
+        std::promise<void> done;
+        loop_.run_in_loop([&] {
+            f();
+            done.set_value();
+        });
+        done.get_future().get();
+    }
+
+private:
+    reactor::EventLoop loop_;
+    reactor::TcpServer server_;
+    reactor::SocketAddress endpoint_;
+    std::vector<reactor::FileDescriptor> accepted_;
+    std::unique_ptr<network::ConnectionPool> pool_;
+    std::thread thread_;
+};
+
+// Polls predicate for up to two seconds
+template<typename Predicate>
+static bool eventually(Predicate predicate) {
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+static bool is_ready(const std::future<network::Connection::Ptr>& future) {
+    return future.wait_for(0s) == std::future_status::ready;
+}
+
+// Dials on demand up to max_size; the next acquire waits for a release
+static void dials_up_to_max_size() {
+    PoolFixture fixture({.max_size = 2});
+    auto first = fixture.acquire();
+    auto second = fixture.acquire();
+    CHECK(first && first->is_connected());
+    CHECK(second && second != first);
+
+    auto third = fixture.acquire(fixture.endpoint());
+    CHECK(eventually([&] { return fixture.pool().stats().waiters == 1; }));
+    CHECK(!is_ready(third));
+    fixture.pool().release(first);
+    auto reused = third.get();
+    CHECK(reused == first);
+
+    auto stats = fixture.pool().stats();
+    CHECK(stats.created == 2);
+    CHECK(stats.leased == 2);
+    CHECK(stats.dialing == 0);
+    fixture.pool().release(second);
+    fixture.pool().release(reused);
+    CHECK(eventually([&] { return fixture.pool().stats().idle == 2; }));
+}
+
+static void acquire_times_out() {
+    PoolFixture fixture({.max_size = 1});
+    auto leased = fixture.acquire();
+    CHECK(leased);
+    CHECK(fixture.acquire(fixture.endpoint(), 20ms).get() == nullptr);
+    auto stats = fixture.pool().stats();
+    CHECK(stats.timeouts == 1);
+    CHECK(stats.waiters == 0);
+    fixture.pool().release(leased);
+}
+
+// Every waiter of an endpoint nobody listens on gets nullptr
+static void failed_dials_fail_waiters() {
+    PoolFixture fixture({.max_size = 4});
+    auto missing = reactor::SocketAddress::unix_path("/nonexistent/connection_pool_test.sock");
+    auto first = fixture.acquire(missing);
+    auto second = fixture.acquire(missing);
+    CHECK(first.get() == nullptr);
+    CHECK(second.get() == nullptr);
+    auto stats = fixture.pool().stats();
+    CHECK(stats.dial_failures == 2);
+    CHECK(stats.waiters == 0);
+    CHECK(stats.dialing == 0);
+}
+
+// An idle connection failing validation is closed and replaced by a new dial
+static void evicts_invalid_idle_connection() {
+    PoolFixture fixture({});
+    std::atomic<bool> valid{true};
+    fixture.pool().set_validator([&valid](network::Connection&) { return valid.load(); });
+    auto first = fixture.acquire();
+    fixture.pool().release(first);
+    CHECK(eventually([&] { return fixture.pool().stats().idle == 1; }));
+
+    valid = false;
+    auto second = fixture.acquire();
+    CHECK(second && second != first);
+    CHECK(!first->is_connected());
+    auto stats = fixture.pool().stats();
+    CHECK(stats.evicted == 1);
+    CHECK(stats.created == 2);
+    fixture.pool().release(second);
+}
+
+static void evicts_expired_idle_connection() {
+    PoolFixture fixture({.idle_timeout = 20ms, .maintenance_interval = 10ms});
+    fixture.pool().release(fixture.acquire());
+    CHECK(eventually([&] { return fixture.pool().stats().evicted == 1; }));
+    CHECK(fixture.pool().stats().idle == 0);
+}
+
+// Destroying the pool hands nullptr to whoever is still waiting
+static void destruction_fails_waiters() {
+    PoolFixture fixture({.max_size = 1});
+    auto leased = fixture.acquire();
+    auto waiting = fixture.acquire(fixture.endpoint(), 0ms);
+    CHECK(eventually([&] { return fixture.pool().stats().waiters == 1; }));
+    fixture.pool().release(leased);
+    CHECK(waiting.get() == leased);
+
+    auto starved = fixture.acquire(fixture.endpoint(), 0ms);
+    CHECK(eventually([&] { return fixture.pool().stats().waiters == 1; }));
+    fixture.destroy_pool();
+    CHECK(is_ready(starved));
+    CHECK(starved.get() == nullptr);
+}
+
+// Maintenance stays out of the way of the per-thread cache tests
+static constexpr network::ConnectionPoolOptions CACHE_OPTIONS{
+    .max_size = 16, .maintenance_interval = std::chrono::milliseconds(60000)};
+
+static void local_cache_reuses_newest_first() {
+    PoolFixture fixture(CACHE_OPTIONS);
+    auto& pool = fixture.pool();
+    auto older = fixture.acquire();
+    auto newer = fixture.acquire();
+    pool.release_local(fixture.endpoint(), older);
+    pool.release_local(fixture.endpoint(), newer);
+    CHECK(pool.stats().cached == 2);
+
+    CHECK(pool.try_acquire_local(fixture.endpoint()) == newer);
+    CHECK(pool.try_acquire_local(fixture.endpoint()) == older);
+    CHECK(pool.try_acquire_local(fixture.endpoint()) == nullptr);
+    CHECK(pool.stats().cached == 0);
+    pool.release(older);
+    pool.release(newer);
+}
+
+// One more than the cache holds pushes the oldest entry to the shared pool
+static void local_cache_overflows_oldest() {
+    PoolFixture fixture(CACHE_OPTIONS);
+    auto& pool = fixture.pool();
+    std::vector<network::Connection::Ptr> connections;
+    for (size_t i = 0; i < 9; ++i) {
+        connections.push_back(fixture.acquire());
+    }
+    for (auto& connection : connections) {
+        pool.release_local(fixture.endpoint(), connection);
+    }
+    CHECK(pool.stats().cached == 8);
+    CHECK(eventually([&] { return pool.stats().idle == 1; }));
+    CHECK(fixture.acquire() == connections[0]);
+
+    for (size_t i = 8; i > 0; --i) {
+        CHECK(pool.try_acquire_local(fixture.endpoint()) == connections[i]);
+    }
+    for (auto& connection : connections) {
+        pool.release(connection);
+    }
+}
+
+// Entries left unused for a maintenance interval go back to the shared pool
+static void maintenance_reclaims_stale_entries() {
+    PoolFixture fixture({.maintenance_interval = 10ms});
+    auto& pool = fixture.pool();
+    auto connection = fixture.acquire();
+    pool.release_local(fixture.endpoint(), connection);
+    CHECK(eventually([&] { return pool.stats().cached == 0 && pool.stats().idle == 1; }));
+    CHECK(pool.try_acquire_local(fixture.endpoint()) == nullptr);
+    CHECK(fixture.acquire() == connection);
+    pool.release(connection);
+}
+
+// A thread that exits leaves its cache to the next thread given its number
+static void recycled_thread_number_inherits_cache() {
+    PoolFixture fixture(CACHE_OPTIONS);
+    auto& pool = fixture.pool();
+    auto connection = fixture.acquire();
+    std::thread([&] { pool.release_local(fixture.endpoint(), connection); }).join();
+
+    network::Connection::Ptr inherited;
+    std::thread([&] { inherited = pool.try_acquire_local(fixture.endpoint()); }).join();
+    CHECK(inherited == connection);
+    pool.release(connection);
+}
+
+int main() {
+    dials_up_to_max_size();
+    acquire_times_out();
+    failed_dials_fail_waiters();
+    evicts_invalid_idle_connection();
+    evicts_expired_idle_connection();
+    destruction_fails_waiters();
+    local_cache_reuses_newest_first();
+    local_cache_overflows_oldest();
+    maintenance_reclaims_stale_entries();
+    recycled_thread_number_inherits_cache();
+    return async_toolkit::test::test_result("connection_pool_test");
+}
@@ -0,0 +1,69 @@
+// Writes through network::Connection to a peer that has gone away, from
+// the buffered queue and with send_file. The write must fail with EPIPE and
+// close the connection instead of raising SIGPIPE, whose default action
+// would kill this test.
+
+#include <async_toolkit/network/connection.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <sys/socket.h>
+
+#include "check.hpp"
+
+using namespace async_toolkit;
+
+// Runs send_some on a connection whose peer is closed; returns the errno
+// the connection closed with, or -1 if it never closed
+static int error_writing_to_closed_peer(
+        const std::function<void(network::Connection&)>& send_some) {
+    reactor::EventLoop loop;
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    close(fds[1]);
+
+    auto connection = std::make_shared<network::Connection>(fds[0], loop);
+    int error = -1;
+    connection->set_close_callback([&] {
+        error = connection->error();
+        loop.stop();
+    });
+    loop.run_after(std::chrono::milliseconds(2000), [&] { loop.stop(); });
+    loop.run_in_loop([&] {
+        connection->start();
+        send_some(*connection);
+    });
+    loop.run();
+    CHECK(!connection->is_connected());
+    return error;
+}
+
+static void buffered_write_to_closed_peer() {
+    int error = error_writing_to_closed_peer([](network::Connection& connection) {
+        connection.send(std::string(1024, 'x'));
+    });
+    CHECK(error == EPIPE);
+}
+
+static void send_file_to_closed_peer() {
+    std::FILE* file = std::tmpfile();
+    CHECK(file != nullptr);
+    std::string contents(64 * 1024, 'f');
+    CHECK(std::fwrite(contents.data(), 1, contents.size(), file) == contents.size());
+    std::fflush(file);
+
+    int error = error_writing_to_closed_peer([&](network::Connection& connection) {
+        connection.send_file(fileno(file), 0, contents.size());
+    });
+    CHECK(error == EPIPE);
+    std::fclose(file);
+}
+
+int main() {
+    buffered_write_to_closed_peer();
+    send_file_to_closed_peer();
+    return async_toolkit::test::test_result("connection_test");
+}
@@ -0,0 +1,179 @@
+// Runs two MultiplexedChannels against each other over a socketpair: the
+// client calls from the main thread and the test decides when and in what
+// order the server answers.
+
+#include <async_toolkit/rpc/multiplexed_channel.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <sys/socket.h>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+
+using namespace async_toolkit;
+using namespace std::chrono_literals;
+
+// A client and a server channel on one loop thread. Requests reaching the
+// server are parked until the test answers them.
+class ChannelPair {
+public:
+    explicit ChannelPair(const rpc::MultiplexedChannelOptions& options) {
+        int fds[2];
+        CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        client_ = std::make_shared<rpc::MultiplexedChannel>(
+            std::make_shared<network::Connection>(fds[0], loop_), loop_, options);
+        server_ = std::make_shared<rpc::MultiplexedChannel>(
+            std::make_shared<network::Connection>(fds[1], loop_), loop_);
+        server_->set_request_handler([this](const rpc::RPCHeaderView& header, std::string body) {
+            std::lock_guard lock(mutex_);
+            requests_.emplace_back(header.sequence_id, std::move(body));
+            arrived_.notify_all();
+        });
+        loop_.run_in_loop([this] {
+            client_->start();
+            server_->start();
+        });
+        thread_ = std::thread([this] { loop_.run(); });
+    }
+
+    ~ChannelPair() {
+        loop_.stop();
+        thread_.join();
+    }
+
+    rpc::MultiplexedChannel& client() { return *client_; }
+    rpc::MultiplexedChannel& server() { return *server_; }
+
+    // Waits until count requests have reached the server and returns them
+    // as (sequence id, body) in arrival order
+    std::vector<std::pair<uint32_t, std::string>> requests(size_t count) {
+        std::unique_lock lock(mutex_);
+        CHECK(arrived_.wait_for(lock, 2s, [&] { return requests_.size() >= count; }));
+        return requests_;
+    }
+
+private:
+    reactor::EventLoop loop_;
+    rpc::MultiplexedChannel::Ptr client_;
+    rpc::MultiplexedChannel::Ptr server_;
+    std::mutex mutex_;
+    std::condition_variable arrived_;
+    std::vector<std::pair<uint32_t, std::string>> requests_;
+    std::thread thread_;
+};
+
+// Polls predicate for up to two seconds
+template<typename Predicate>
+static bool eventually(Predicate predicate) {
+    auto deadline = std::chrono::steady_clock::now() + 2s;
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+static std::errc error_of(executor::Future<std::string>& future) {
+    try {
+        future.get();
+    } catch (const std::system_error& error) {
+        return static_cast<std::errc>(error.code().value());
+    }
+    return std::errc{};
+}
+
+static void out_of_order_responses() {
+    ChannelPair pair({});
+    std::vector<executor::Future<std::string>> calls;
+    for (int i = 0; i < 3; ++i) {
+        calls.push_back(pair.client().call("echo", std::to_string(i)));
+    }
+    auto requests = pair.requests(3);
+    for (auto it = requests.rbegin(); it != requests.rend(); ++it) {
+        pair.server().respond(it->first, "reply " + it->second);
+    }
+    for (int i = 0; i < 3; ++i) {
+        CHECK(calls[i].get() == "reply " + std::to_string(i));
+    }
+    auto stats = pair.client().stats();
+    CHECK(stats.completed == 3);
+    CHECK(stats.late == 0);
+    CHECK(stats.in_flight == 0);
+}
+
+// With one slot the second call reuses the slot of the first, which timed
+// out; the first call's response must not complete the second
+static void late_response_after_timeout() {
+    ChannelPair pair({.max_in_flight = 1});
+    auto first = pair.client().call("echo", "first", 20ms);
+    CHECK(error_of(first) == std::errc::timed_out);
+
+    auto second = pair.client().call("echo", "second", 0ms);
+    auto requests = pair.requests(2);
+    pair.server().respond(requests[0].first, "late");
+    CHECK(eventually([&] { return pair.client().stats().late == 1; }));
+    CHECK(!second.is_ready());
+
+    pair.server().respond(requests[1].first, "on time");
+    CHECK(second.get() == "on time");
+    auto stats = pair.client().stats();
+    CHECK(stats.timeouts == 1);
+    CHECK(stats.completed == 1);
+}
+
+static void max_in_flight_rejection() {
+    ChannelPair pair({.max_in_flight = 2});
+    auto first = pair.client().call("echo", "first");
+    auto second = pair.client().call("echo", "second");
+    CHECK(!pair.client().has_capacity());
+
+    auto refused = pair.client().call("echo", "refused");
+    CHECK(refused.is_ready());
+    CHECK(error_of(refused) == std::errc::resource_unavailable_try_again);
+    CHECK(pair.client().stats().rejected == 1);
+
+    auto requests = pair.requests(2);
+    pair.server().respond(requests[0].first, "done");
+    CHECK(first.get() == "done");
+    auto third = pair.client().call("echo", "third");
+    requests = pair.requests(3);
+    CHECK(requests[2].second == "third");
+    pair.server().respond(requests[1].first, "done");
+    pair.server().respond(requests[2].first, "done");
+    CHECK(second.get() == "done");
+    CHECK(third.get() == "done");
+}
+
+static void close_fails_pending_calls() {
+    ChannelPair pair({});
+    auto first = pair.client().call("echo", "first");
+    auto second = pair.client().call("echo", "second");
+    pair.requests(2);
+
+    pair.client().close();
+    CHECK(error_of(first) == std::errc::connection_aborted);
+    CHECK(error_of(second) == std::errc::connection_aborted);
+    CHECK(!pair.client().is_open());
+    CHECK(pair.client().stats().failed == 2);
+    CHECK(pair.client().stats().in_flight == 0);
+
+    auto after = pair.client().call("echo", "after");
+    CHECK(error_of(after) == std::errc::connection_aborted);
+    CHECK(pair.client().stats().rejected == 1);
+}
+
+int main() {
+    out_of_order_responses();
+    late_response_after_timeout();
+    max_in_flight_rejection();
+    close_fails_pending_calls();
+    return async_toolkit::test::test_result("multiplexed_channel_test");
+}
@@ -0,0 +1,112 @@
+// Runs the TaskGraph loop, subflow and execute_async examples from the
+// README, so a snippet that silently does nothing fails the build's tests.
+
+#include <async_toolkit/graph/task_graph.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "check.hpp"
+
+using async_toolkit::TaskPool;
+
+static void loop_example(TaskPool& pool) {
+    auto graph = async_toolkit::graph::make_task_graph<int>();
+    int iteration = -1;
+
+    auto init = graph->add_task([&]{ return iteration = 0; });
+    auto body = graph->add_task([&]{ return ++iteration; });
+    auto more = graph->add_condition([&]() -> size_t { return iteration < 5 ? 0 : 1; });
+    auto done = graph->add_task([&]{ return iteration; });
+    graph->add_dependency(body, init);
+    graph->add_dependency(more, body);
+    graph->add_dependency(body, more);
+    graph->add_dependency(done, more);
+
+    auto results = graph->execute(pool);
+    CHECK(iteration == 5);
+    CHECK(results.size() == 4);
+    CHECK(results[1] == 5);
+    CHECK(results[3] == 5);
+}
+
+static void subflow_example(TaskPool& pool) {
+    auto graph = async_toolkit::graph::make_task_graph<int>();
+    std::vector<int> shards{1, 2, 3, 4};
+    std::atomic<int> processed{0};
+    auto process = [&processed](int shard) {
+        processed.fetch_add(shard);
+        return shard;
+    };
+
+    auto fan_out = graph->add_subflow([&](auto& subflow) {
+        for (auto& shard : shards) {
+            subflow.add_task([&shard, &process]{ return process(shard); });
+        }
+        return static_cast<int>(shards.size());
+    });
+    auto after = graph->add_task([&]{ return processed.load(); });
+    graph->add_dependency(after, fan_out);
+
+    auto results = graph->execute(pool);
+    CHECK(results.size() == 2);
+    CHECK(results[0] == 4);
+    CHECK(results[1] == 10);
+}
+
+// The loop without its entry task has no root and must not run silently
+static void loop_without_entry_throws(TaskPool& pool) {
+    auto graph = async_toolkit::graph::make_task_graph<int>();
+    int iteration = 0;
+
+    auto body = graph->add_task([&]{ return ++iteration; });
+    auto more = graph->add_condition([&]() -> size_t { return iteration < 5 ? 0 : 1; });
+    auto done = graph->add_task([&]{ return iteration; });
+    graph->add_dependency(more, body);
+    graph->add_dependency(body, more);
+    graph->add_dependency(done, more);
+
+    bool threw = false;
+    try {
+        graph->execute(pool);
+    } catch (const std::logic_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+    CHECK(iteration == 0);
+}
+
+// execute_async() completes its future with the results or the first error
+static void execute_async_example(TaskPool& pool) {
+    auto graph = async_toolkit::graph::make_task_graph<int>();
+    auto task1 = graph->add_task([]{ return 1; });
+    auto task2 = graph->add_task([]{ return 2; });
+    auto task3 = graph->add_task([]{ return 3; });
+    graph->add_dependency(task3, task1);
+    graph->add_dependency(task3, task2);
+
+    auto sum = graph->execute_async(pool).then([](std::vector<int> results) {
+        return results[0] + results[1] + results[2];
+    });
+    CHECK(sum.get() == 6);
+
+    auto failing = graph->add_task([]() -> int { throw std::runtime_error("node failed"); });
+    graph->add_dependency(failing, task3);
+    bool threw = false;
+    try {
+        graph->execute_async(pool).get();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+int main() {
+    TaskPool pool(2);
+    loop_example(pool);
+    subflow_example(pool);
+    loop_without_entry_throws(pool);
+    execute_async_example(pool);
+    return async_toolkit::test::test_result("task_graph_readme_test");
+}